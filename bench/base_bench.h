@@ -0,0 +1,25 @@
+/* bench/base_bench.h */
+
+#include <time.h>
+
+double bench_now(void);
+
+/* times `iters` runs of `body` and prints the cost of one */
+#define bench(label, iters, body) bench_per(label, iters, 1, body)
+
+/* same, but per item when each run handles `items` of them */
+#define bench_per(label, iters, items, body) do { \
+  long iters_ = iters; \
+  double start_ = bench_now(); \
+  for (long i = 0; i < iters_; i++) { body; } \
+  double ns_ = (bench_now() - start_) / iters_ / (items); \
+  printf("%-32s %10.1f ns\n", label, ns_); \
+} while (0)
+
+int env_bench(void);
+int read_bench(void);
+int eval_bench(void);
+int list_bench(void);
+int error_bench(void);
+int num_bench(void);
+int vm_bench(void);
@@ -0,0 +1,21 @@
+/* bench/bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+double bench_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  env_bench();
+  read_bench();
+  eval_bench();
+  list_bench();
+  error_bench();
+  num_bench();
+  vm_bench();
+  return 0;
+}
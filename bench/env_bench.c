@@ -0,0 +1,43 @@
+/* bench/env_bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+/* looks up every one of `size` globals in turn, from the global env */
+void env_bench_lookup(int size) {
+  Env *e = env_new();
+  Val **syms = malloc(sizeof(Val*) * size);
+  char name[32];
+  for (int i = 0; i < size; i++) {
+    snprintf(name, sizeof(name), "g%i", i);
+    syms[i] = val_sym(name);
+    Val *v = val_num(i);
+    env_put(e, syms[i], v);
+    val_del(v);
+  }
+
+  char label[64];
+  snprintf(label, sizeof(label), "env_get, %i globals", size);
+  bench(label, 200000, val_del(env_get(e, syms[i % size])));
+
+  /* a lambda frame two levels in, still resolving a global */
+  Env *frame = env_new();
+  frame->parent = e;
+  Val *local = val_sym("x");
+  env_put(frame, local, syms[0]);
+  snprintf(label, sizeof(label), "env_get via frame, %i globals", size);
+  bench(label, 200000, val_del(env_get(frame, syms[i % size])));
+
+  val_del(local);
+  env_del(frame);
+  for (int i = 0; i < size; i++) { val_del(syms[i]); }
+  free(syms);
+  env_del(e);
+}
+
+int env_bench(void) {
+  env_bench_lookup(10);
+  env_bench_lookup(1000);
+  env_bench_lookup(100000);
+  return 0;
+}
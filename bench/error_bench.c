@@ -0,0 +1,43 @@
+/* bench/error_bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+/* evaluates an expression that fails, per error */
+void error_bench_run(Env *e, char *label, Val *v) {
+  bench(label, 1000000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+}
+
+int error_bench(void) {
+  Env *e = env_init();
+
+  Val *v = val_sexpr();
+  val_append(v, val_sym("/"));
+  val_append(v, val_num(1));
+  val_append(v, val_num(0));
+  error_bench_run(e, "division by zero", v);
+
+  v = val_sexpr();
+  val_append(v, val_sym("head"));
+  val_append(v, val_num(1));
+  error_bench_run(e, "wrong argument type", v);
+
+  v = val_sexpr();
+  val_append(v, val_sym("head"));
+  val_append(v, val_qexpr());
+  val_append(v, val_qexpr());
+  error_bench_run(e, "wrong argument count", v);
+
+  /* (+ x (+ 1 2) ... (+ 1 2)) with x unbound */
+  v = val_sexpr();
+  val_append(v, val_sym("+"));
+  val_append(v, val_sym("x"));
+  for (int i = 0; i < 100; i++) {
+    val_append(v, val_read("+ 1 2"));
+  }
+  error_bench_run(e, "unbound, then 100 sums", v);
+
+  env_del(e);
+  return 0;
+}
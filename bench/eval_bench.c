@@ -0,0 +1,102 @@
+/* bench/eval_bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+/* (first x x ... x) with size copies of x */
+Val *eval_bench_call(char *first, Val *x, int size) {
+  Val *v = val_sexpr();
+  val_append(v, val_sym(first));
+  for (int i = 0; i < size; i++) {
+    val_append(v, val_copy(x));
+  }
+  return v;
+}
+
+/* defines name as a lambda over params, returning 0 */
+void eval_bench_lambda(Env *e, char *name, Val *params) {
+  Val *body = val_qexpr();
+  val_append(body, val_num(0));
+  Val *f = val_lambda(params, body);
+  Val *k = val_sym(name);
+  env_put(e, k, f);
+  val_del(k);
+  val_del(f);
+}
+
+void eval_bench_run(Env *e, char *name, Val *v, int size, int iters) {
+  char label[64];
+  snprintf(label, sizeof(label), "%s, %i args", name, size);
+  bench_per(label, iters, size, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+}
+
+void eval_bench_size(int size, int iters) {
+  Env *e = env_init();
+
+  Val *params = val_qexpr();
+  for (int i = 0; i < size; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "a%i", i);
+    val_append(params, val_sym(name));
+  }
+  eval_bench_lambda(e, "f", params);
+
+  params = val_qexpr();
+  val_append(params, val_sym("&"));
+  val_append(params, val_sym("xs"));
+  eval_bench_lambda(e, "g", params);
+
+  Val *one = val_qexpr();
+  val_append(one, val_num(1));
+
+  eval_bench_run(e, "+", eval_bench_call("+", one->cell[0], size), size, iters);
+  eval_bench_run(e, "join", eval_bench_call("join", one, size), size, iters);
+  eval_bench_run(e, "lambda", eval_bench_call("f", one->cell[0], size), size, iters);
+  eval_bench_run(e, "lambda &", eval_bench_call("g", one->cell[0], size), size, iters);
+
+  val_del(one);
+  env_del(e);
+}
+
+/* calls a lambda with `bound` arguments already applied, per call */
+void eval_bench_closure(int bound, int iters) {
+  Env *e = env_init();
+
+  Val *params = val_qexpr();
+  Val *call = val_sexpr();
+  val_append(call, val_sym("f"));
+  for (int i = 0; i <= bound; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "a%i", i);
+    val_append(params, val_sym(name));
+    if (i < bound) { val_append(call, val_num(i)); }
+  }
+  eval_bench_lambda(e, "f", params);
+
+  Val *k = val_sym("g");
+  Val *g = val_eval(e, call);
+  env_put(e, k, g);
+  val_del(k);
+  val_del(g);
+
+  Val *v = val_sexpr();
+  val_append(v, val_sym("g"));
+  val_append(v, val_num(1));
+
+  char label[64];
+  snprintf(label, sizeof(label), "call, %i bound", bound);
+  bench(label, iters, val_del(val_eval(e, val_copy(v))));
+
+  val_del(v);
+  env_del(e);
+}
+
+/* argument lists consumed left to right, per argument */
+int eval_bench(void) {
+  eval_bench_closure(0, 1000000);
+  eval_bench_closure(100, 100000);
+  eval_bench_size(1000, 100);
+  eval_bench_size(100000, 1);
+  return 0;
+}
@@ -0,0 +1,40 @@
+/* bench/list_bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+/*
+ * walks a list with tail the way a recursive lambda would, each frame
+ * keeping its own list alive while the next one is taken
+ */
+void list_bench_walk(Env *e, Val *x) {
+  int size = x->count;
+  Val **frames = malloc(sizeof(Val*) * (size + 1));
+  frames[0] = val_ref(x);
+  for (int i = 0; i < size; i++) {
+    Val *args = val_append(val_sexpr(), val_ref(frames[i]));
+    frames[i + 1] = builtin_tail(e, args);
+    val_del(builtin_head(e, val_append(val_sexpr(), val_ref(frames[i]))));
+  }
+  for (int i = 0; i <= size; i++) { val_del(frames[i]); }
+  free(frames);
+}
+
+void list_bench_size(Env *e, int size, int iters) {
+  Val *x = val_qexpr();
+  for (int i = 0; i < size; i++) { val_append(x, val_num(i)); }
+
+  char label[64];
+  snprintf(label, sizeof(label), "head/tail walk, %i cells", size);
+  bench_per(label, iters, size, list_bench_walk(e, x));
+  val_del(x);
+}
+
+/* per element walked */
+int list_bench(void) {
+  Env *e = env_init();
+  list_bench_size(e, 1000, 100);
+  list_bench_size(e, 50000, 1);
+  env_del(e);
+  return 0;
+}
@@ -0,0 +1,105 @@
+/* bench/num_bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+/* (* 1 2 ... n) */
+Val *num_bench_factorial(int n) {
+  Val *v = val_sexpr();
+  val_append(v, val_sym("*"));
+  for (int i = 1; i <= n; i++) {
+    val_append(v, val_num(i));
+  }
+  return v;
+}
+
+/* (op 0.5 1.5 ... ), plus a trailing fixnum when mixed */
+Val *num_bench_floats(char *op, int n, int mixed) {
+  Val *v = val_sexpr();
+  val_append(v, val_sym(op));
+  for (int i = 0; i < n; i++) {
+    val_append(v, val_dbl(i + 0.5));
+  }
+  if (mixed) { val_append(v, val_num(1)); }
+  return v;
+}
+
+/* (+ (+ ... (+ 1 1) ... 1) 1) with depth adds */
+Val *num_bench_nested_add(int depth) {
+  Val *v = val_num(1);
+  for (int i = 0; i < depth; i++) {
+    Val *add = val_sexpr();
+    val_append(add, val_sym("+"));
+    val_append(add, v);
+    val_append(add, val_num(1));
+    v = add;
+  }
+  return v;
+}
+
+/* defines add as (\ {a b} {+ a b}) and returns (add 1 2) */
+Val *num_bench_lambda_add(Env *e) {
+  Val *v = val_read("def {add} (\\ {a b} {+ a b})");
+  val_del(val_eval(e, v));
+  return val_read("add 1 2");
+}
+
+int num_bench(void) {
+  Env *e = env_init();
+
+  Val *v = num_bench_factorial(20);
+  bench("factorial 20, fixnums", 1000000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  v = num_bench_factorial(10000);
+  bench("factorial 10000, bignums", 10, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  /* the builtins alone, on an argument list that the extra ref keeps alive */
+  v = val_read("1 2");
+  bench("builtin + on 2 fixnums", 100000000, val_del(builtin_add(e, val_ref(v))));
+  bench("builtin max on 2 fixnums", 100000000, val_del(builtin_max(e, val_ref(v))));
+  val_del(v);
+
+  v = num_bench_nested_add(1000);
+  bench_per("nested (+ x 1), per add", 10000, 1000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  v = num_bench_lambda_add(e);
+  bench("(add 1 2), add = (+ a b)", 1000000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  /* the folds alone, without evaluating each argument first */
+  char *ops[] = {"+", "max"};
+  for (int k = 0; k < 2; k++) {
+    for (int mixed = 0; mixed <= 1; mixed++) {
+      Val *args = num_bench_floats(ops[k], 1000, mixed);
+      val_del(val_pop(args, 0));
+      char label[64];
+      snprintf(label, sizeof(label), "builtin %s on 1000 %s, per item",
+        ops[k], mixed ? "mixed" : "floats");
+      BuiltIn f = k ? builtin_max : builtin_add;
+      bench_per(label, 100000, 1000, val_del(f(e, val_ref(args))));
+      val_del(args);
+    }
+  }
+
+  v = num_bench_floats("+", 1000, 0);
+  bench_per("sum 1000 floats, per item", 100000, 1000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  v = num_bench_floats("+", 1000, 1);
+  bench_per("sum 1000 mixed, per item", 100000, 1000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  v = num_bench_floats("max", 1000, 0);
+  bench_per("max 1000 floats, per item", 100000, 1000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  v = num_bench_floats("max", 1000, 1);
+  bench_per("max 1000 mixed, per item", 100000, 1000, val_del(val_eval(e, val_copy(v))));
+  val_del(v);
+
+  env_del(e);
+  return 0;
+}
@@ -0,0 +1,47 @@
+/* bench/read_bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+/* `{x0 1 x1 1 ... }` with size cells, half of them symbols */
+char *read_bench_source(int size) {
+  char *src = malloc(size * 16 + 3);
+  char *p = src;
+  *p++ = '{';
+  for (int i = 0; i < size; i++) {
+    p += i % 2 ? sprintf(p, " 1") : sprintf(p, " x%i", i % 1000);
+  }
+  *p++ = '}';
+  *p = '\0';
+  return src;
+}
+
+/* reads a literal list and drops it, per cell */
+void read_bench_size(int size, int iters) {
+  char *src = read_bench_source(size);
+  char label[64];
+  snprintf(label, sizeof(label), "val_read, %i cells", size);
+  bench_per(label, iters, size, val_del(val_read(src)));
+  free(src);
+}
+
+/* appends then pops from the back, per cell */
+void read_bench_append_pop(int size, int iters) {
+  char label[64];
+  snprintf(label, sizeof(label), "append/pop, %i cells", size);
+  bench_per(label, iters, size, {
+    Val *v = val_qexpr();
+    for (int j = 0; j < size; j++) { val_append(v, val_fixnum(j)); }
+    while (v->count) { val_pop(v, v->count - 1); }
+    val_del(v);
+  });
+}
+
+int read_bench(void) {
+  read_bench_size(1000, 1000);
+  read_bench_size(100000, 10);
+  read_bench_size(1000000, 1);
+  read_bench_append_pop(1000, 1000);
+  read_bench_append_pop(1000000, 1);
+  return 0;
+}
@@ -0,0 +1,56 @@
+/* bench/vm_bench.c */
+
+#include "../repl.h"
+#include "base_bench.h"
+
+/* reads and evaluates each line of src in e, for definitions */
+void vm_bench_defs(Env *e, char **src, int n) {
+  for (int i = 0; i < n; i++) {
+    val_del(val_eval(e, val_read(src[i])));
+  }
+}
+
+/* runs expr under the tree-walker, then the vm, per evaluation */
+void vm_bench_run(Env *e, char *label, char *expr, int iters) {
+  Val *v = val_read(expr);
+  char name[64];
+  for (int vm = 0; vm <= 1; vm++) {
+    eval_vm = vm;
+    snprintf(name, sizeof(name), "%s, %s", label, vm ? "vm" : "walk");
+    bench(name, iters, val_del(val_eval(e, val_copy(v))));
+  }
+  eval_vm = 0;
+  val_del(v);
+}
+
+int vm_bench(void) {
+  Env *e = env_init();
+  char *defs[] = {
+    "def {sumsq} (\\ {a b} {+ (* a a) (* b b)})",
+    "def {poly} (\\ {x} {+ (* x x x) (* 3 x x) (* 3 x) 1})",
+    "def {dist} (\\ {a b c} {sumsq (sumsq a b) (sumsq b c)})",
+    "def {sum} (\\ {n} {if (== n 0) {0} {+ n (sum (- n 1))}})",
+    "def {fib} (\\ {n} {if (< n 2) {n} {+ (fib (- n 1)) (fib (- n 2))}})",
+  };
+  vm_bench_defs(e, defs, 5);
+
+  vm_bench_run(e, "(sumsq 3 4)", "sumsq 3 4", 1000000);
+  vm_bench_run(e, "(dist 1 2 3)", "dist 1 2 3", 1000000);
+
+  char sum[2048] = "+";
+  for (int i = 1; i <= 100; i++) {
+    char term[32];
+    snprintf(term, sizeof(term), " (poly %i)", i);
+    strcat(sum, term);
+  }
+  vm_bench_run(e, "(+ (poly 1) ... (poly 100))", sum, 10000);
+
+  /* each call's lookups used to walk every frame below it */
+  vm_bench_run(e, "(sum 1000), not a tail call", "sum 1000", 1000);
+
+  /* comparisons, branches and calls, with little arithmetic between */
+  vm_bench_run(e, "(fib 20)", "fib 20", 100);
+
+  env_del(e);
+  return 0;
+}
@@ -3,71 +3,181 @@
 #include "repl.h"
 
 Env *env_new(void) {
-  Env *e = malloc(sizeof(Env));
+  Env *e = mem_alloc(MEM_ENV, sizeof(Env));
   e->parent = NULL;
+  e->bound = NULL;
   e->count = 0;
+  e->capacity = 0;
   e->syms = NULL;
   e->vals = NULL;
+  e->index = NULL;
+  e->buckets = 0;
   return e;
 }
 
 Env *env_copy(Env *e) {
-  Env *c = malloc(sizeof(Env));
+  Env *c = mem_alloc(MEM_ENV, sizeof(Env));
   c->parent = e->parent;
+  c->bound = e->bound;
   c->count = e->count;
+  c->capacity = e->count;
   c->syms = malloc(sizeof(char*) * c->count);
   c->vals = malloc(sizeof(Val*) * c->count);
   for (int i = 0; i < c->count; i++) {
-    c->syms[i] = malloc(strlen(e->syms[i] + 1));
-    strcpy(c->syms[i], e->syms[i]);
-    c->vals[i] = val_copy(e->vals[i]);
+    c->syms[i] = e->syms[i];
+    c->vals[i] = val_ref(e->vals[i]);
+  }
+  c->index = NULL;
+  c->buckets = e->buckets;
+  if (e->index) {
+    c->index = malloc(sizeof(int) * c->buckets);
+    memcpy(c->index, e->index, sizeof(int) * c->buckets);
   }
   return c;
 }
 
 void env_del(Env *e) {
   for (int i = 0; i < e->count; i++) {
-    free(e->syms[i]);
     val_del(e->vals[i]);
   }
   free(e->syms);
   free(e->vals);
-  free(e);
+  free(e->index);
+  mem_free(MEM_ENV, e, sizeof(Env));
 }
 
-Val *env_get(Env *e, Val *k) {
+/* drops every binding, keeping the arrays for the next ones */
+void env_clear(Env *e) {
   for (int i = 0; i < e->count; i++) {
-    if (strcmp(e->syms[i], k->sym) == 0) {
-      return val_copy(e->vals[i]);
+    val_del(e->vals[i]);
+  }
+  e->count = 0;
+  free(e->index);
+  e->index = NULL;
+  e->buckets = 0;
+  e->parent = NULL;
+  e->bound = NULL;
+}
+
+/* interned names are at least 8-byte aligned, so drop the low bits */
+unsigned long env_hash(char *sym) {
+  return ((uintptr_t)sym >> 3) * 11400714819323198485UL;
+}
+
+/* index slots hold position + 1, so 0 is empty */
+void env_index_add(Env *e, int i) {
+  unsigned long mask = e->buckets - 1;
+  unsigned long b = env_hash(e->syms[i]) & mask;
+  while (e->index[b]) { b = (b + 1) & mask; }
+  e->index[b] = i + 1;
+}
+
+void env_index_build(Env *e, int buckets) {
+  free(e->index);
+  e->buckets = buckets;
+  e->index = calloc(buckets, sizeof(int));
+  for (int i = 0; i < e->count; i++) {
+    env_index_add(e, i);
+  }
+}
+
+/* position of sym in e's own bindings, or -1 */
+int env_find(Env *e, char *sym) {
+  if (!e->index) {
+    for (int i = 0; i < e->count; i++) {
+      if (e->syms[i] == sym) { return i; }
     }
+    return -1;
   }
-  if (e->parent) {
-    return env_get(e->parent, k);
+
+  unsigned long mask = e->buckets - 1;
+  unsigned long b = env_hash(sym) & mask;
+  while (e->index[b]) {
+    int i = e->index[b] - 1;
+    if (e->syms[i] == sym) { return i; }
+    b = (b + 1) & mask;
+  }
+  return -1;
+}
+
+Val *env_get(Env *e, Val *k) {
+  for (; e; e = e->parent) {
+    int i = env_find(e, k->sym);
+    if (i >= 0) { return val_ref(e->vals[i]); }
+    if (e->bound && (i = env_find(e->bound, k->sym)) >= 0) {
+      return val_ref(e->bound->vals[i]);
+    }
   }
   return val_err(err_unbound_symbol(k->sym));
 }
 
-void env_def(Env *e, Val *k, Val *v) {
+/* the global env; every call frame's parent */
+Env *env_root(Env *e) {
   while (e->parent) { e = e->parent; }
-  env_put(e, k, v);
+  return e;
 }
 
+void env_def(Env *e, Val *k, Val *v) {
+  env_put(env_root(e), k, v);
+}
+
+/* values put in an env that outlives the arena are promoted out of it */
+Val *env_own(Env *e, Val *v) {
+  return mem_arena_owns(e) ? val_ref(v) : val_promote(v);
+}
+
+/*
+ * bumped by every definition, so a cached global (see vm.c) is good as
+ * long as this hasn't changed. frames bind their arguments with env_bind or
+ * env_push, which don't bump it.
+ */
+long env_version = 0;
+
 void env_put(Env *e, Val *k, Val *v) {
-  for (int i = 0; i < e->count; i++) {
-    if (strcmp(e->syms[i], k->sym) == 0) {
-      val_del(e->vals[i]);
-      e->vals[i] = val_copy(v);
-      return;
-    }
+  env_version++;
+  env_bind(e, k->sym, v);
+}
+
+/* adds a binding for a sym e doesn't have, to a value e already owns */
+void env_append(Env *e, char *sym, Val *v) {
+  if (e->count == e->capacity) {
+    e->capacity = e->capacity ? e->capacity * 2 : 4;
+    e->syms = realloc(e->syms, sizeof(char*) * e->capacity);
+    e->vals = realloc(e->vals, sizeof(Val*) * e->capacity);
   }
+  e->syms[e->count] = sym;
+  e->vals[e->count] = v;
   e->count++;
 
-  e->vals = realloc(e->vals, sizeof(Val*) * e->count);
-  e->vals[e->count - 1] = val_copy(v);
+  if (e->count > ENV_LINEAR_MAX && 2 * e->count > e->buckets) {
+    env_index_build(e, e->buckets ? e->buckets * 2 : 4 * ENV_LINEAR_MAX);
+  } else if (e->index) {
+    env_index_add(e, e->count - 1);
+  }
+}
+
+void env_bind(Env *e, char *sym, Val *v) {
+  int i = env_find(e, sym);
+  if (i >= 0) {
+    Val *old = e->vals[i];
+    e->vals[i] = env_own(e, v);
+    val_del(old);
+    return;
+  }
+  env_append(e, sym, env_own(e, v));
+}
 
-  e->syms = realloc(e->syms, sizeof(char*) * e->count);
-  e->syms[e->count - 1] = malloc(strlen(k->sym) + 1);
-  strcpy(e->syms[e->count - 1], k->sym);
+/*
+ * binds a sym e doesn't have yet, taking v rather than sharing it. a call
+ * frame binds its arguments this way, straight from the vm's stack.
+ */
+void env_push(Env *e, char *sym, Val *v) {
+  if (!val_is_fixnum(v)) {
+    Val *own = env_own(e, v);
+    val_del(v);
+    v = own;
+  }
+  env_append(e, sym, v);
 }
 
 void env_add_builtin(Env *e, char *name, BuiltIn func) {
@@ -77,4 +187,3 @@ void env_add_builtin(Env *e, char *name, BuiltIn func) {
   val_del(k);
   val_del(v);
 }
-
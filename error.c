@@ -13,106 +13,133 @@ char *err_name(int e) {
   return "Error";
 }
 
-Err *err_new(int type, char *fmt, ...) {
-  Err *e = malloc(sizeof(Err));
+Err *err_alloc(int type) {
+  Err *e = mem_alloc(MEM_ERR, sizeof(Err));
   e->type = type;
+  e->fixed = 0;
+  e->name = err_name(type);
+  e->det = NULL;
+  e->fmt = NULL;
+  return e;
+}
+
+Err *err_fixed(int type, char *det) {
+  Err *e = err_alloc(type);
+  e->fixed = 1;
+  e->det = det;
+  return e;
+}
 
-  char *name = err_name(type);
-  e->name = malloc(strlen(name) + 1);
-  strcpy(e->name, name);
+/* the caller fills in args, one per %i or %s in fmt */
+Err *err_lazy(int type, char *fmt) {
+  Err *e = err_alloc(type);
+  e->fmt = fmt;
+  return e;
+}
+
+/* a fmt with nothing to format is used as is, without allocating */
+Err *err_new(int type, char *fmt, ...) {
+  if (!strchr(fmt, '%')) { return err_fixed(type, fmt); }
 
+  char det[512];
   va_list va;
   va_start(va, fmt);
-  e->det = malloc(512);
-  vsnprintf(e->det, 511, fmt, va);
-  e->det = realloc(e->det, strlen(e->det) + 1);
+  int n = vsnprintf(det, sizeof(det), fmt, va);
   va_end(va);
+  if (n >= (int)sizeof(det)) { n = sizeof(det) - 1; }
 
+  Err *e = err_alloc(type);
+  e->det = malloc(n + 1);
+  memcpy(e->det, det, n + 1);
   return e;
 }
 
+char *err_det(Err *e) {
+  if (e->det) { return e->det; }
+
+  char det[512];
+  int n = 0;
+  int a = 0;
+  for (char *f = e->fmt; *f && n < (int)sizeof(det) - 1; f++) {
+    if (*f != '%') {
+      det[n++] = *f;
+      continue;
+    }
+    f++;
+    if (*f == 'i') {
+      n += snprintf(det + n, sizeof(det) - n, "%li", e->args[a++].i);
+    } else if (*f == 's') {
+      n += snprintf(det + n, sizeof(det) - n, "%s", e->args[a++].s);
+    } else {
+      det[n++] = *f;
+    }
+  }
+  if (n >= (int)sizeof(det)) { n = sizeof(det) - 1; }
+  det[n] = '\0';
+
+  e->det = malloc(n + 1);
+  memcpy(e->det, det, n + 1);
+  return e->det;
+}
+
 Err *err_copy(Err *e) {
-  Err *c = malloc(sizeof(Err));
-  c->type = e->type;
-  c->name = malloc(strlen(e->name) + 1);
-  strcpy(c->name, e->name);
-  c->det = malloc(strlen(e->det) + 1);
-  strcpy(c->det, e->det);
+  Err *c = mem_alloc(MEM_ERR, sizeof(Err));
+  *c = *e;
+  if (!e->fixed && e->det) {
+    c->det = malloc(strlen(e->det) + 1);
+    strcpy(c->det, e->det);
+  }
   return c;
 }
 
 void err_del(Err *e) {
-  free(e->name);
-  free(e->det);
-  free(e);
-}
-
-Err *err_parse_number(char *given) {
-  return err_new(
-    ERR_VALUE,
-    "unable to parse %s as number",
-    given
-  );
+  if (!e->fixed) { free(e->det); }
+  mem_free(MEM_ERR, e, sizeof(Err));
 }
 
 Err *err_unbound_symbol(char *given) {
-  return err_new(
-    ERR_VALUE,
-    "unbound symbol: %s",
-    given
-  );
+  Err *e = err_lazy(ERR_VALUE, "unbound symbol: %s");
+  e->args[0].s = given;
+  return e;
 }
 
 Err *err_arg_type(char *expected, char *given) {
-  return err_new(
-    ERR_TYPE,
-    "expected %s, got %s",
-    expected,
-    given
-  );
+  Err *e = err_lazy(ERR_TYPE, "expected %s, got %s");
+  e->args[0].s = expected;
+  e->args[1].s = given;
+  return e;
 }
 
 Err *err_cell_arg_type(int index, char *expected, char *given) {
-  return err_new(
-    ERR_TYPE,
-    "expected %s at index %i, got %s",
-    expected,
-    index,
-    given
-  );
+  Err *e = err_lazy(ERR_TYPE, "expected %s at index %i, got %s");
+  e->args[0].s = expected;
+  e->args[1].i = index;
+  e->args[2].s = given;
+  return e;
 }
 
 Err *err_empty_args(void) {
-  return err_new(
-    ERR_ARG,
-    "expected some arguments, got 0"
-  );
+  return err_fixed(ERR_ARG, "expected some arguments, got 0");
 }
 
 Err *err_arg_count(int expected, int given) {
-  return err_new(
-    ERR_ARG,
-    "expected %i arguments, got %i",
-    expected,
-    given
-  );
+  Err *e = err_lazy(ERR_ARG, "expected %i arguments, got %i");
+  e->args[0].i = expected;
+  e->args[1].i = given;
+  return e;
 }
 
 Err *err_empty_cell_args(int index) {
-  return err_new(
-    ERR_ARG,
-    "expected some arguments at index %i, got 0",
-    index
-  );
+  Err *e = err_lazy(ERR_ARG, "expected some arguments at index %i, got 0");
+  e->args[0].i = index;
+  return e;
 }
 
 Err *err_cell_arg_count(int index, int expected, int given) {
-  return err_new(
-    ERR_ARG,
-    "expected %i arguments at index %i, got %i",
-    expected,
-    index,
-    given
-  );
+  Err *e = err_lazy(ERR_ARG, "expected %i arguments at index %i, got %i");
+  e->args[0].i = expected;
+  e->args[1].i = index;
+  e->args[2].i = given;
+  return e;
 }
 
@@ -4,21 +4,21 @@
 
 #define ASSERT(val, cond, err) \
   if (!(cond)) { \
+    Err *err_ = err; \
     val_del(val); \
-    return val_err(err); \
+    return val_err(err_); \
   }
 
 #define ASSERT_ARG_COUNT(val_to_del, val, expected) \
   if (val->count != expected) { \
-    int given = val->count; \
+    Err *err = err_arg_count(expected, val->count); \
     val_del(val_to_del); \
-    Err *err = err_arg_count(expected, given); \
     return val_err(err); \
   }
 
 #define ASSERT_ARG_TYPE(val_to_del, val, expected) \
-  if (val->type != expected) { \
-    char *given = type_name(val->type); \
+  if (val_type(val) != expected) { \
+    char *given = type_name(val_type(val)); \
     char *expected_name = type_name(expected); \
     val_del(val_to_del); \
     Err *err = err_arg_type(expected_name, given); \
@@ -26,8 +26,8 @@
   }
 
 #define ASSERT_CELL_ARG_TYPE(val_to_del, val, index, expected) \
-  if (val->cell[index]->type != expected) { \
-    char *given = type_name(val->cell[index]->type); \
+  if (val_type(val->cell[index]) != expected) { \
+    char *given = type_name(val_type(val->cell[index])); \
     char *expected_name = type_name(expected); \
     val_del(val_to_del); \
     Err *err = err_cell_arg_type(index, expected_name, given); \
@@ -37,6 +37,7 @@
 char *type_name(int t) {
   switch (t) {
     case VAL_NUM: return "number";
+    case VAL_DBL: return "float";
     case VAL_ERR: return "error";
     case VAL_SYM: return "symbol";
     case VAL_FUNC: return "function";
@@ -51,10 +52,15 @@ Val *builtin_head(Env *e, Val *args) {
   ASSERT_CELL_ARG_TYPE(args, args, 0, VAL_QEXPR);
   ASSERT(args, args->cell[0]->count > 0, err_empty_cell_args(0));
   Val *v = val_take(args, 0);
-  while (v->count > 1) {
-    val_del(val_pop(v, 1));
+  /* a list only we hold is cut down in place */
+  if (v->refs == 1 && !val_is_view(v)) {
+    val_truncate(v, 1);
+    return v;
   }
-  return v;
+  /* a view would keep all of a shared list alive, so copy its first cell */
+  Val *h = val_append(val_qexpr(), val_ref(v->cell[0]));
+  val_del(v);
+  return h;
 }
 
 Val *builtin_tail(Env *e, Val *args) {
@@ -62,31 +68,161 @@ Val *builtin_tail(Env *e, Val *args) {
   ASSERT_CELL_ARG_TYPE(args, args, 0, VAL_QEXPR);
   ASSERT(args, args->cell[0]->count > 0, err_empty_cell_args(0));
   Val *v = val_take(args, 0);
-  val_del(val_pop(v, 0));
-  return v;
+  return val_slice(v, 1, v->count - 1);
 }
 
 Val *builtin_list(Env *e, Val *args) {
+  args = val_unshare(args);
   args->type = VAL_QEXPR;
   return args;
 }
 
-Val *builtin_eval(Env *e, Val *args) {
+/*
+ * eval and if finish by evaluating a q-expression, which val_eval_sexpr
+ * and the vm do in tail position. these check the arguments and take
+ * that q-expression into *q, or return an error.
+ */
+Val *eval_branch(Val *args, Val **q) {
   ASSERT_ARG_COUNT(args, args, 1);
   ASSERT_CELL_ARG_TYPE(args, args, 0, VAL_QEXPR);
-  Val *v = val_take(args, 0);
-  v->type = VAL_SEXPR;
-  return val_eval(e, v);
+  *q = val_take(args, 0);
+  return NULL;
+}
+
+/* any number but 0 is true; a bignum never is 0 */
+Val *if_branch(Val *args, Val **q) {
+  ASSERT_ARG_COUNT(args, args, 3);
+  ASSERT_CELL_ARG_TYPE(args, args, 0, VAL_NUM);
+  ASSERT_CELL_ARG_TYPE(args, args, 1, VAL_QEXPR);
+  ASSERT_CELL_ARG_TYPE(args, args, 2, VAL_QEXPR);
+  *q = val_take(args, args->cell[0] != val_fixnum(0) ? 1 : 2);
+  return NULL;
+}
+
+/* takes q and evaluates it as an s-expression */
+Val *val_eval_qexpr(Env *e, Val *q) {
+  /* the vm compiles the cells where they are, without retyping them */
+  if (eval_vm) { return vm_eval(e, q); }
+  q = val_unshare(q);
+  q->type = VAL_SEXPR;
+  return val_eval(e, q);
+}
+
+Val *builtin_eval(Env *e, Val *args) {
+  Val *q;
+  Val *err = eval_branch(args, &q);
+  return err ? err : val_eval_qexpr(e, q);
+}
+
+Val *builtin_if(Env *e, Val *args) {
+  Val *q;
+  Val *err = if_branch(args, &q);
+  return err ? err : val_eval_qexpr(e, q);
+}
+
+/* -1, 0 or 1 as x is less than, equal to or greater than y */
+int num_cmp(Val *x, Val *y) {
+  if (val_is_fixnum(x) && val_is_fixnum(y)) {
+    long a = val_get_num(x);
+    long b = val_get_num(y);
+    return (a > b) - (a < b);
+  }
+  if (val_type(x) == VAL_DBL || val_type(y) == VAL_DBL) {
+    double a = val_get_dbl(x);
+    double b = val_get_dbl(y);
+    return (a > b) - (a < b);
+  }
+  return big_cmp(x, y);
+}
+
+#define CMP_LT 1
+#define CMP_EQ 2
+#define CMP_GT 4
+
+/*
+ * 1 if the order of two numbers is one of those in mask, otherwise 0.
+ * like num_fold, the cells are only borrowed, so the vm can compare
+ * them where they are on its stack.
+ */
+Val *num_compare(int mask, Val **cell, int count) {
+  if (count != 2) { return val_err(err_arg_count(2, count)); }
+  if (val_is_fixnum(cell[0]) && val_is_fixnum(cell[1])) {
+    long a = val_get_num(cell[0]);
+    long b = val_get_num(cell[1]);
+    return val_fixnum((mask >> ((a > b) - (a < b) + 1)) & 1);
+  }
+  for (int i = 0; i < 2; i++) {
+    int t = val_type(cell[i]);
+    if (t != VAL_NUM && t != VAL_DBL) {
+      return val_err(err_cell_arg_type(i, type_name(VAL_NUM), type_name(t)));
+    }
+  }
+  int c = num_cmp(cell[0], cell[1]);
+  return val_fixnum((mask >> (c + 1)) & 1);
+}
+
+Val *builtin_cmp(Env *e, Val *v, int mask) {
+  Val *r = num_compare(mask, v->cell, v->count);
+  val_del(v);
+  return r;
+}
+
+Val *builtin_lt(Env *e, Val *v) {
+  return builtin_cmp(e, v, CMP_LT);
+}
+
+Val *builtin_le(Env *e, Val *v) {
+  return builtin_cmp(e, v, CMP_LT | CMP_EQ);
+}
+
+Val *builtin_gt(Env *e, Val *v) {
+  return builtin_cmp(e, v, CMP_GT);
+}
+
+Val *builtin_ge(Env *e, Val *v) {
+  return builtin_cmp(e, v, CMP_GT | CMP_EQ);
+}
+
+Val *builtin_eq(Env *e, Val *v) {
+  return builtin_cmp(e, v, CMP_EQ);
+}
+
+Val *builtin_ne(Env *e, Val *v) {
+  return builtin_cmp(e, v, CMP_LT | CMP_GT);
+}
+
+/* the mask num_compare takes for a comparison builtin, or 0 */
+int cmp_op(BuiltIn f) {
+  if (f == builtin_lt) { return CMP_LT; }
+  if (f == builtin_le) { return CMP_LT | CMP_EQ; }
+  if (f == builtin_gt) { return CMP_GT; }
+  if (f == builtin_ge) { return CMP_GT | CMP_EQ; }
+  if (f == builtin_eq) { return CMP_EQ; }
+  if (f == builtin_ne) { return CMP_LT | CMP_GT; }
+  return 0;
 }
 
 Val *builtin_join(Env *e, Val *args) {
+  ASSERT(args, args->count > 0, err_empty_args());
   for (int i = 0; i < args->count; i++) {
     ASSERT_CELL_ARG_TYPE(args, args, i, VAL_QEXPR);
   }
-  Val *v = val_pop(args, 0);
-  while (args->count) {
-    v = val_join(v, val_pop(args, 0));
+  int total = 0;
+  for (int i = 0; i < args->count; i++) {
+    total += args->cell[i]->count;
+  }
+
+  /* take the cells in order, leaving args empty instead of shifting it */
+  Val *v = args->cell[0];
+  args->cell[0] = NULL;
+  v = val_unshare(v);
+  val_reserve(v, total);
+  for (int i = 1; i < args->count; i++) {
+    Val *c = args->cell[i];
+    args->cell[i] = NULL;
+    val_splice(v, v->count, c);
   }
+  args->count = 0;
   val_del(args);
   return v;
 }
@@ -119,6 +255,44 @@ Val *builtin_assign(Env *e, Val *v) {
   return builtin_var(e, v, ":=");
 }
 
+int lambda_has_param(Val *f, char *sym) {
+  for (int i = 0; i < f->args->count; i++) {
+    if (f->args->cell[i]->sym == sym) { return 1; }
+  }
+  return 0;
+}
+
+/*
+ * scoping is lexical, with flat closures. a call frame's parent is the
+ * global env, so a body sees its params, the globals, and whatever its
+ * lambda captured when it was made: the value of each symbol anywhere in
+ * the body that the call frame it was made in had bound. captured values
+ * go in the lambda's env, which its frames search as their bound.
+ *
+ * a name defined in the frame after the lambda is made isn't captured,
+ * so a local helper can't call itself by name; a global one can.
+ */
+void lambda_capture(Env *e, Val *f, Val *v) {
+  for (int i = 0; i < v->count; i++) {
+    Val *c = v->cell[i];
+    if (val_type(c) == VAL_SEXPR || val_type(c) == VAL_QEXPR) {
+      lambda_capture(e, f, c);
+      continue;
+    }
+    if (val_type(c) != VAL_SYM) { continue; }
+    if (lambda_has_param(f, c->sym) || env_find(f->env, c->sym) >= 0) {
+      continue;
+    }
+
+    int j = env_find(e, c->sym);
+    if (j >= 0) {
+      env_bind(f->env, c->sym, e->vals[j]);
+    } else if (e->bound && (j = env_find(e->bound, c->sym)) >= 0) {
+      env_bind(f->env, c->sym, e->bound->vals[j]);
+    }
+  }
+}
+
 Val *builtin_lambda(Env *e, Val *v) {
   ASSERT_ARG_COUNT(v, v, 2);
   ASSERT_CELL_ARG_TYPE(v, v, 0, VAL_QEXPR);
@@ -131,165 +305,481 @@ Val *builtin_lambda(Env *e, Val *v) {
   Val *body = val_pop(v, 0);
   val_del(v);
 
-  return val_lambda(args, body);
+  Val *f = val_lambda(args, body);
+  if (e->parent) { lambda_capture(e, f, body); }
+  return f;
 }
 
-Val *builtin_op(Env *e, Val *v, char *op);
+/*
+ * each arithmetic builtin is a NumOp holding a kernel per representation,
+ * so builtin_op picks them once per call instead of comparing op names.
+ * the fixnum kernels return 1 when the result doesn't fit in a long.
+ */
+struct NumOp {
+  int div;
+  int neg;
+  int (*fix)(long a, long b, long *r);
+  Val *(*big)(Val *x, Val *y);
+  double (*dbl)(double a, double b);
+  double (*reduce)(double a, double *x, int n);
+};
+
+int fix_add(long a, long b, long *r) {
+  return __builtin_add_overflow(a, b, r);
+}
+
+int fix_sub(long a, long b, long *r) {
+  return __builtin_sub_overflow(a, b, r);
+}
+
+int fix_mul(long a, long b, long *r) {
+  return __builtin_mul_overflow(a, b, r);
+}
+
+int fix_div(long a, long b, long *r) {
+  if (a == LONG_MIN && b == -1) { return 1; }
+  *r = a / b;
+  return 0;
+}
+
+int fix_mod(long a, long b, long *r) {
+  if (a == LONG_MIN && b == -1) { return 1; }
+  *r = a % b;
+  return 0;
+}
+
+int fix_min(long a, long b, long *r) {
+  *r = b < a ? b : a;
+  return 0;
+}
+
+int fix_max(long a, long b, long *r) {
+  *r = b > a ? b : a;
+  return 0;
+}
+
+double dbl_add(double a, double b) { return a + b; }
+double dbl_sub(double a, double b) { return a - b; }
+double dbl_mul(double a, double b) { return a * b; }
+double dbl_div(double a, double b) { return a / b; }
+double dbl_lesser(double a, double b) { return b < a ? b : a; }
+double dbl_greater(double a, double b) { return b > a ? b : a; }
+
+NumOp num_add = {0, 0, fix_add, big_add, dbl_add, dbl_sum};
+NumOp num_sub = {0, 1, fix_sub, big_sub, dbl_sub, NULL};
+NumOp num_mul = {0, 0, fix_mul, big_mul, dbl_mul, dbl_prod};
+NumOp num_div = {1, 0, fix_div, big_div, dbl_div, NULL};
+NumOp num_mod = {1, 0, fix_mod, big_mod, fmod, NULL};
+NumOp num_min = {0, 0, fix_min, big_min, dbl_lesser, NULL};
+NumOp num_max = {0, 0, fix_max, big_max, dbl_greater, NULL};
+
+/* the NumOp behind an arithmetic builtin, if f is one */
+NumOp *num_op(BuiltIn f) {
+  if (f == builtin_add) { return &num_add; }
+  if (f == builtin_sub) { return &num_sub; }
+  if (f == builtin_mul) { return &num_mul; }
+  if (f == builtin_div) { return &num_div; }
+  if (f == builtin_mod) { return &num_mod; }
+  if (f == builtin_min) { return &num_min; }
+  if (f == builtin_max) { return &num_max; }
+  return NULL;
+}
+
+Val *builtin_op(Env *e, Val *v, NumOp *op);
 
 Val *builtin_add(Env *e, Val *v) {
-  return builtin_op(e, v, "+");
+  return builtin_op(e, v, &num_add);
 }
 
 Val *builtin_sub(Env *e, Val *v) {
-  return builtin_op(e, v, "-");
+  return builtin_op(e, v, &num_sub);
 }
 
 Val *builtin_mul(Env *e, Val *v) {
-  return builtin_op(e, v, "*");
+  return builtin_op(e, v, &num_mul);
 }
 
 Val *builtin_div(Env *e, Val *v) {
-  return builtin_op(e, v, "/");
+  return builtin_op(e, v, &num_div);
 }
 
 Val *builtin_mod(Env *e, Val *v) {
-  return builtin_op(e, v, "%");
+  return builtin_op(e, v, &num_mod);
 }
 
 Val *builtin_min(Env *e, Val *v) {
-  return builtin_op(e, v, "min");
+  return builtin_op(e, v, &num_min);
 }
 
 Val *builtin_max(Env *e, Val *v) {
-  return builtin_op(e, v, "max");
+  return builtin_op(e, v, &num_max);
+}
+
+Val *builtin_stats(Env *e, Val *v) {
+  ASSERT_ARG_COUNT(v, v, 1);
+  ASSERT_CELL_ARG_TYPE(v, v, 0, VAL_QEXPR);
+  Val *names = v->cell[0];
+  for (int i = 0; i < names->count; i++) {
+    ASSERT_CELL_ARG_TYPE(v, names, i, VAL_SYM);
+  }
+
+  for (int i = 0; i < names->count; i++) {
+    char *name = names->cell[i]->sym;
+    if (strcmp(name, "mem") == 0) {
+      mem_print_stats();
+    } else if (strcmp(name, "gc") == 0) {
+      gc_print_stats();
+    } else if (strcmp(name, "eval") == 0) {
+      eval_print_stats();
+    } else if (strcmp(name, "vm") == 0) {
+      vm_print_stats();
+    } else if (strcmp(name, "stack") == 0) {
+      vm_print_stack();
+    } else {
+      Err *err = err_new(ERR_VALUE, "unknown stats: %s", name);
+      val_del(v);
+      return val_err(err);
+    }
+  }
+
+  val_del(v);
+  return val_sexpr();
 }
 
-Val *builtin_op(Env *e, Val *v, char *op) {
-  for (int i=0; i < v->count; i++) {
-    ASSERT_CELL_ARG_TYPE(v, v, i, VAL_NUM);
+Val *builtin_gc(Env *e, Val *v) {
+  ASSERT_ARG_COUNT(v, v, 1);
+  ASSERT_CELL_ARG_TYPE(v, v, 0, VAL_NUM);
+  Val *n = v->cell[0];
+  ASSERT(v, val_is_fixnum(n) && val_get_num(n) >= 0,
+    err_fixed(ERR_VALUE, "expected a non-negative fixnum threshold"));
+  gc_set_threshold(val_get_num(n));
+  val_del(v);
+  return val_num(gc_collect(NULL));
+}
+
+#define DBL_BLOCK 64
+
+/*
+ * a float anywhere makes the whole fold float, and dividing by zero is
+ * still an error. when every argument is a float, + and * gather them a
+ * block at a time for the vector kernels in num.c
+ */
+Val *num_fold_dbl(NumOp *op, Val **cell, int count, int homogeneous) {
+  double a = val_get_dbl(cell[0]);
+  int i = 1;
+
+  if (op->neg && count == 1) {
+    a = -a;
   }
 
-  Val *a = val_pop(v, 0);
+  if (homogeneous && op->reduce) {
+    double buf[DBL_BLOCK];
+    while (i < count) {
+      int n = 0;
+      for (; n < DBL_BLOCK && i < count; n++, i++) {
+        buf[n] = cell[i]->dbl;
+      }
+      a = op->reduce(a, buf, n);
+    }
+  }
+
+  for (; i < count; i++) {
+    double b = val_get_dbl(cell[i]);
 
-  if ((strcmp(op, "-") == 0) && v->count == 0) {
-    a->num *= -1;
+    if (op->div && b == 0) {
+      return val_err(err_fixed(ERR_ARITHMETIC, "division by zero"));
+    }
+    a = op->dbl(a, b);
   }
 
-  while (v->count > 0) {
-    Val *b = val_pop(v, 0);
+  return val_dbl(a);
+}
 
-    if (strstr("/%", op) && b->num == 0) {
-      val_del(a);
-      val_del(b);
-      a = val_err(err_new(ERR_ARITHMETIC, "division by zero"));
-      break;
+/*
+ * folds count cells, which it borrows, in overflow-checked longs while
+ * they are fixnums, and carries on in bignums from the first one that
+ * doesn't fit
+ */
+Val *num_fold(NumOp *op, Val **cell, int count) {
+  /* two fixnums, checked by their tags alone */
+  if (count == 2 && val_is_fixnum(cell[0]) && val_is_fixnum(cell[1])) {
+    long a = val_get_num(cell[0]);
+    long b = val_get_num(cell[1]);
+    long r;
+    if (!(op->div && b == 0) && !op->fix(a, b, &r)) {
+      return val_num(r);
+    }
+  }
+
+  int dbls = 0;
+  for (int i=0; i < count; i++) {
+    int t = val_type(cell[i]);
+    if (t == VAL_DBL) {
+      dbls++;
+    } else if (t != VAL_NUM) {
+      return val_err(err_cell_arg_type(i, type_name(VAL_NUM), type_name(t)));
+    }
+  }
+  if (dbls) { return num_fold_dbl(op, cell, count, dbls == count); }
+
+  Val *x = cell[0];
+  int i = 1;
+
+  if (val_is_fixnum(x)) {
+    long a = val_get_num(x);
+
+    if (op->neg && count == 1) {
+      a *= -1;
     }
 
-    if (strcmp(op, "+") == 0) { a->num += b->num; }
-    if (strcmp(op, "-") == 0) { a->num -= b->num; }
-    if (strcmp(op, "*") == 0) { a->num *= b->num; }
-    if (strcmp(op, "/") == 0) { a->num /= b->num; }
-    if (strcmp(op, "%") == 0) { a->num %= b->num; }
-    if (strcmp(op, "min") == 0 && b->num < a->num) {
-      a->num = b->num;
+    for (; i < count && val_is_fixnum(cell[i]); i++) {
+      long b = val_get_num(cell[i]);
+
+      if (op->div && b == 0) {
+        return val_err(err_fixed(ERR_ARITHMETIC, "division by zero"));
+      }
+      long r;
+      if (op->fix(a, b, &r)) { break; }
+      a = r;
     }
-    if (strcmp(op, "max") == 0 && b->num > a->num) {
-      a->num = b->num;
+
+    if (i == count) { return val_num(a); }
+    x = val_num(a);
+  } else if (op->neg && count == 1) {
+    x = big_neg(x);
+  } else {
+    x = val_ref(x);
+  }
+
+  for (; i < count; i++) {
+    Val *b = cell[i];
+
+    if (op->div && b == val_fixnum(0)) {
+      val_del(x);
+      return val_err(err_fixed(ERR_ARITHMETIC, "division by zero"));
     }
 
-    val_del(b);
+    Val *r = op->big(x, b);
+    val_del(x);
+    x = r;
   }
 
+  return x;
+}
+
+Val *builtin_op(Env *e, Val *v, NumOp *op) {
+  Val *r = num_fold(op, v->cell, v->count);
   val_del(v);
-  return a;
+  return r;
 }
 
+/* counts for `(stats {eval})` */
+typedef struct {
+  long sexprs;
+  long errors;
+  long skipped;
+} EvalStats;
+
+static EvalStats eval_stats;
+
+void eval_print_stats(void) {
+  printf(
+    "eval: s-expressions %li, errors %li, cells skipped %li\n",
+    eval_stats.sexprs,
+    eval_stats.errors,
+    eval_stats.skipped
+  );
+}
+
+/*
+ * the first cell to fail is the result, and the rest are never evaluated.
+ *
+ * the call that ends an s-expression is made in a loop rather than by
+ * recursing, so tail calls run in constant C stack. a lambda called in
+ * tail position gets a frame that replaces the caller's.
+ */
 Val *val_eval_sexpr(Env *e, Val *v) {
-  if (v->count == 0) { return v; }
+  Env *frame = NULL;
+  Val *fn = NULL;
+  Val *r;
 
-  for (int i=0; i < v->count; i++) {
-    v->cell[i] = val_eval(e, v->cell[i]);
-  }
+  while (1) {
+    if (v->count == 0) {
+      r = v;
+      break;
+    }
+    eval_stats.sexprs++;
+
+    /* a lone s-expression is in tail position too */
+    if (v->count == 1 && val_type(v->cell[0]) == VAL_SEXPR) {
+      Val *c = val_ref(v->cell[0]);
+      val_del(v);
+      v = c;
+      continue;
+    }
 
-  if (v->count == 1) { return val_take(v, 0); }
+    v = val_unshare(v);
+    int i = 0;
+    for (; i < v->count; i++) {
+      /* val_eval takes the cell, so don't let the collector follow it */
+      Val *c = v->cell[i];
+      v->cell[i] = NULL;
+      v->cell[i] = val_eval(e, c);
+      if (val_type(v->cell[i]) == VAL_ERR) { break; }
+    }
 
-  for (int i=0; i < v->count; i++) {
-    if (v->cell[i]->type == VAL_ERR) { return val_take(v, i); }
-  }
+    if (i < v->count) {
+      eval_stats.errors++;
+      eval_stats.skipped += v->count - i - 1;
+      r = val_take(v, i);
+      break;
+    }
 
-  Val *f = val_pop(v, 0);
-  if (f->type != VAL_FUNC) {
-    char *given = type_name(f->type);
-    char *expected = type_name(VAL_FUNC);
-    val_del(f);
-    val_del(v);
-    return val_err(err_cell_arg_type(0, expected, given));
-  }
+    if (v->count == 1) {
+      r = val_take(v, 0);
+      break;
+    }
+
+    Val *f = val_pop(v, 0);
+    if (val_type(f) != VAL_FUNC) {
+      char *given = type_name(val_type(f));
+      char *expected = type_name(VAL_FUNC);
+      val_del(f);
+      val_del(v);
+      r = val_err(err_cell_arg_type(0, expected, given));
+      break;
+    }
+
+    Val *q;
+    Env *callee = NULL;
+    r = val_call_tail(e, f, v, &q, &callee);
+    if (r) {
+      val_del(f);
+      break;
+    }
 
-  Val *r = val_call(e, f, v);
-  val_del(f);
+    if (callee) {
+      if (frame) {
+        env_del(frame);
+        val_del(fn);
+      }
+      frame = callee;
+      fn = f;
+      e = callee;
+    } else {
+      val_del(f);
+    }
+
+    v = val_unshare(q);
+    v->type = VAL_SEXPR;
+  }
 
+  if (frame) {
+    env_del(frame);
+    val_del(fn);
+  }
   return r;
 }
 
 Val *val_eval(Env *e, Val *v) {
-  if (v->type == VAL_SYM) {
+  if (val_is_fixnum(v)) { return v; }
+  if (eval_vm && val_type(v) == VAL_SEXPR) { return vm_eval(e, v); }
+  if (val_type(v) == VAL_SYM) {
     Val *x = env_get(e, v);
     val_del(v);
     return x;
   }
-  if (v->type == VAL_SEXPR) { return val_eval_sexpr(e, v); }
+  if (val_type(v) == VAL_SEXPR) { return val_eval_sexpr(e, v); }
   return v;
 }
 
-Val *val_call(Env *e, Val *f, Val *v) {
+/*
+ * lambdas are never changed by a call: arguments are bound in a fresh
+ * frame, and a partial application returns a new lambda.
+ *
+ * a builtin, or a lambda given too few arguments, finishes the call here
+ * and returns the result. otherwise the call ends by evaluating the
+ * q-expression left in *q, in *frame if it is a lambda's new call frame,
+ * and NULL is returned.
+ */
+Val *val_call_tail(Env *e, Val *f, Val *v, Val **q, Env **frame) {
+  if (f->func == builtin_eval) { return eval_branch(v, q); }
+  if (f->func == builtin_if) { return if_branch(v, q); }
   if (f->func) { return f->func(e, v); }
 
   int given = v->count;
   int total = f->args->count;
+  Env *callee = env_new();
+
+  /* bind by index, then drop the bound params all at once */
+  int i = 0;
+  for (; i < v->count; i++) {
+    if (i == total) {
+      env_del(callee);
+      val_del(v);
+      return val_err(err_arg_count(total, given));
+    }
 
-  while (v->count) {
-    ASSERT(
-      v,
-      f->args->count != 0,
-      err_arg_count(total, given)
-    );
-
-    Val *sym = val_pop(f->args, 0);
+    Val *sym = f->args->cell[i];
     if (strcmp(sym->sym, "&") == 0) {
-      ASSERT_ARG_COUNT(v, f->args, 1);
-      Val *nsym = val_pop(f->args, 0);
-      env_put(f->env, nsym, builtin_list(e, v));
-      val_del(sym);
-      val_del(nsym);
+      if (total != i + 2) {
+        env_del(callee);
+        val_del(v);
+        return val_err(err_arg_count(1, total - i - 1));
+      }
+      val_drop(v, 0, i);
+      v = builtin_list(e, v);
+      env_bind(callee, f->args->cell[i + 1]->sym, v);
+      i += 2;
       break;
     }
 
-    Val *val = val_pop(v, 0);
-    env_put(f->env, sym, val);
-    val_del(sym);
-    val_del(val);
+    env_bind(callee, sym->sym, v->cell[i]);
   }
-
   val_del(v);
 
-  if (f->args->count > 0 && strcmp(f->args->cell[0]->sym, "&") == 0) {
-    ASSERT_ARG_COUNT(v, f->args, 2);
-    val_del(val_pop(f->args, 0));
-    Val *sym = val_pop(f->args, 0);
+  if (i < total && strcmp(f->args->cell[i]->sym, "&") == 0) {
+    if (total != i + 2) {
+      env_del(callee);
+      return val_err(err_arg_count(2, total - i));
+    }
     Val *val = val_qexpr();
-    env_put(f->env, sym, val);
-    val_del(sym);
+    env_bind(callee, f->args->cell[i + 1]->sym, val);
     val_del(val);
+    i += 2;
+  }
+
+  if (i == total) {
+    callee->parent = env_root(e);
+    callee->bound = f->env;
+    *frame = callee;
+    *q = val_ref(f->body);
+    return NULL;
   }
 
-  if (f->args->count == 0) {
-    f->env->parent = e;
-    return builtin_eval(
-      f->env,
-      val_append(val_sexpr(), val_copy(f->body))
-    );
+  /* a partial application keeps everything bound so far in a new lambda */
+  for (int j = 0; j < f->env->count; j++) {
+    env_bind(callee, f->env->syms[j], f->env->vals[j]);
   }
-  return val_copy(f);
+  Val *p = val_lambda(val_slice(val_ref(f->args), i, total - i), val_ref(f->body));
+  env_del(p->env);
+  p->env = callee;
+  return p;
 }
 
+Val *val_call(Env *e, Val *f, Val *v) {
+  Val *q;
+  Env *frame = NULL;
+  Val *r = val_call_tail(e, f, v, &q, &frame);
+  if (r) { return r; }
+  if (!frame) { return val_eval_qexpr(e, q); }
+
+  if (eval_vm) {
+    val_del(q);
+    r = vm_call(frame, f);
+  } else {
+    r = val_eval_qexpr(frame, q);
+  }
+  env_del(frame);
+  return r;
+}
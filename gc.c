@@ -0,0 +1,245 @@
+/* gc.c */
+
+#include "repl.h"
+#include <time.h>
+
+/*
+ * Reference counts free most values the moment they die, but can't see
+ * garbage that still holds references: cycles, and values leaked on
+ * error paths. The collector tracks every container (s-expressions,
+ * q-expressions and lambdas, the only values that reference others) and
+ * traces them whenever the heap grows past the trigger.
+ *
+ * Roots are the global env, the active call frames and the value the
+ * REPL is working on. Between REPL lines only the global env is left, so
+ * gc_safepoint traces from it alone and also reclaims leaks. A
+ * collection triggered mid-eval can't see C locals, so it counts each
+ * container's references from other containers and treats any with more
+ * references than that as a root: the global env's bindings, lambdas
+ * whose frames are running, the REPL's current value and half-built
+ * argument lists are all found that way.
+ */
+
+#ifndef GC_THRESHOLD
+#define GC_THRESHOLD (1024 * 1024)
+#endif
+
+/* after a collection the trigger moves to GC_GROWTH times the live heap */
+#ifndef GC_GROWTH
+#define GC_GROWTH 2
+#endif
+
+typedef struct {
+  Val **objs;
+  int count;
+  int capacity;
+
+  long threshold;
+  long trigger;
+  int collecting;
+
+  long collections;
+  long reclaimed;
+  double pause_total;
+  double pause_max;
+} Gc;
+
+static Gc gc = { .threshold = GC_THRESHOLD, .trigger = GC_THRESHOLD };
+
+int *gc_slot(Val *v) {
+  return val_type(v) == VAL_FUNC ? &v->fn_slot : &v->slot;
+}
+
+int gc_tracked(Val *v) {
+  if (val_is_fixnum(v)) { return 0; }
+  switch (val_type(v)) {
+    case VAL_FUNC: return !v->func && v->fn_slot >= 0;
+    case VAL_SEXPR:
+    case VAL_QEXPR: return v->slot >= 0;
+  }
+  return 0;
+}
+
+Val *gc_track(Val *v) {
+  if (mem_arena_owns(v)) {
+    *gc_slot(v) = -1;
+    return v;
+  }
+
+  if (gc.threshold && mem_heap_bytes() > gc.trigger) {
+    gc_collect(NULL);
+  }
+
+  if (gc.count == gc.capacity) {
+    gc.capacity = gc.capacity ? gc.capacity * 2 : 256;
+    gc.objs = realloc(gc.objs, sizeof(Val*) * gc.capacity);
+  }
+  *gc_slot(v) = gc.count;
+  gc.objs[gc.count++] = v;
+  return v;
+}
+
+void gc_untrack(Val *v) {
+  if (!gc_tracked(v)) { return; }
+  int i = *gc_slot(v);
+  Val *last = gc.objs[--gc.count];
+  gc.objs[i] = last;
+  *gc_slot(last) = i;
+  *gc_slot(v) = -1;
+}
+
+/* scratch space for one collection, indexed by slot */
+typedef struct {
+  long *refs;
+  Val **stack;
+  int top;
+} GcScan;
+
+/* a lambda's code holds its consts, and its subs' */
+void gc_code_children(Code *c, void (*fn)(Val*, GcScan*), GcScan *scan) {
+  for (int i = 0; i < c->nconsts; i++) {
+    fn(c->consts[i], scan);
+    if (c->subs[i]) { gc_code_children(c->subs[i], fn, scan); }
+  }
+}
+
+/* calls fn on each value v holds a reference to */
+void gc_children(Val *v, void (*fn)(Val*, GcScan*), GcScan *scan) {
+  if (val_type(v) == VAL_FUNC) {
+    for (int i = 0; i < v->env->count; i++) {
+      fn(v->env->vals[i], scan);
+    }
+    fn(v->args, scan);
+    fn(v->body, scan);
+    if (v->code) { gc_code_children(v->code, fn, scan); }
+    return;
+  }
+  /* a view's cells are held by its base, not by the view */
+  if (v->base) {
+    fn(v->base, scan);
+    return;
+  }
+  for (int i = 0; i < v->count; i++) {
+    /* a cell is briefly empty while val_eval_sexpr evaluates it */
+    if (v->cell[i]) { fn(v->cell[i], scan); }
+  }
+}
+
+void gc_uncount(Val *c, GcScan *scan) {
+  if (gc_tracked(c)) { scan->refs[*gc_slot(c)]--; }
+}
+
+/* refs doubles as the mark: -1 once a container is known to be live */
+void gc_reach(Val *c, GcScan *scan) {
+  if (!gc_tracked(c) || scan->refs[*gc_slot(c)] == -1) { return; }
+  scan->refs[*gc_slot(c)] = -1;
+  scan->stack[scan->top++] = c;
+}
+
+void gc_reach_env(Env *e, GcScan *scan) {
+  for (; e; e = e->parent) {
+    for (int i = 0; i < e->count; i++) {
+      gc_reach(e->vals[i], scan);
+    }
+  }
+}
+
+void gc_mark(GcScan *scan) {
+  while (scan->top) {
+    gc_children(scan->stack[--scan->top], gc_reach, scan);
+  }
+}
+
+double gc_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+/*
+ * with a root env, traces from its bindings only; without one, from every
+ * container referenced from outside the tracked heap. returns the number
+ * of containers reclaimed.
+ */
+long gc_collect(Env *root) {
+  if (gc.collecting) { return 0; }
+  gc.collecting = 1;
+  double start = gc_now();
+
+  GcScan scan;
+  scan.refs = malloc(sizeof(long) * (gc.count + 1));
+  scan.stack = malloc(sizeof(Val*) * (gc.count + 1));
+  scan.top = 0;
+
+  if (root) {
+    memset(scan.refs, 0, sizeof(long) * gc.count);
+    gc_reach_env(root, &scan);
+  } else {
+    for (int i = 0; i < gc.count; i++) {
+      scan.refs[i] = gc.objs[i]->refs;
+    }
+    for (int i = 0; i < gc.count; i++) {
+      gc_children(gc.objs[i], gc_uncount, &scan);
+    }
+    for (int i = 0; i < gc.count; i++) {
+      if (scan.refs[i] > 0) { gc_reach(gc.objs[i], &scan); }
+    }
+  }
+  gc_mark(&scan);
+
+  int n = 0;
+  Val **garbage = scan.stack;
+  for (int i = 0; i < gc.count; i++) {
+    if (scan.refs[i] != -1) { garbage[n++] = gc.objs[i]; }
+  }
+  free(scan.refs);
+
+  /*
+   * pin everything first so releasing one piece of garbage can't free
+   * another that's still waiting to be cleared
+   */
+  for (int i = 0; i < n; i++) { garbage[i]->refs++; }
+  for (int i = 0; i < n; i++) { val_clear(garbage[i]); }
+  for (int i = 0; i < n; i++) { val_free(garbage[i]); }
+  free(garbage);
+
+  long heap = mem_heap_bytes() * GC_GROWTH;
+  gc.trigger = heap > gc.threshold ? heap : gc.threshold;
+
+  double pause = gc_now() - start;
+  gc.collections++;
+  gc.reclaimed += n;
+  gc.pause_total += pause;
+  if (pause > gc.pause_max) { gc.pause_max = pause; }
+  gc.collecting = 0;
+  return n;
+}
+
+/* called between REPL lines, when nothing outside root can be live */
+void gc_safepoint(Env *root) {
+  if (gc.threshold && mem_heap_bytes() > gc.trigger) {
+    gc_collect(root);
+  }
+}
+
+/* 0 turns automatic collection off */
+void gc_set_threshold(long bytes) {
+  gc.threshold = bytes;
+  gc.trigger = bytes;
+}
+
+void gc_print_stats(void) {
+  printf(
+    "gc: collections %li, reclaimed %li, tracked %i\n"
+    "  heap %li bytes, trigger %li bytes, threshold %li bytes\n"
+    "  pause total %.3fms, max %.3fms\n",
+    gc.collections,
+    gc.reclaimed,
+    gc.count,
+    mem_heap_bytes(),
+    gc.trigger,
+    gc.threshold,
+    gc.pause_total,
+    gc.pause_max
+  );
+}
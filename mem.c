@@ -0,0 +1,235 @@
+/* mem.c */
+
+#include "repl.h"
+
+/*
+ * Val, Env and Err objects come from here. Built with
+ * -DMEM_POOL, each kind gets a free list per 8-byte size class, refilled
+ * a slab at a time; otherwise every call goes straight to malloc/free.
+ * Both modes keep the same counters so the two can be compared with
+ * `(stats {mem})`.
+ *
+ * Built with -DMEM_ARENA, everything allocated between mem_arena_begin
+ * and mem_arena_end is bumped out of a chunk instead, freeing it is a
+ * no-op, and mem_arena_end releases all of it at once.
+ */
+
+#define MEM_CLASSES 8
+#define MEM_CLASS_BYTES 8
+#define MEM_SLAB_BYTES (16 * 1024)
+#define MEM_CHUNK_BYTES (64 * 1024)
+
+typedef struct MemNode MemNode;
+
+struct MemNode {
+  MemNode *next;
+};
+
+typedef struct {
+  MemNode *free;
+  long slabs;
+  long live;
+  long allocs;
+  long hits;
+} MemPool;
+
+typedef struct MemChunk MemChunk;
+
+struct MemChunk {
+  MemChunk *prev;
+  size_t size;
+  size_t used;
+  char data[];
+};
+
+typedef struct {
+  int active;
+  MemChunk *chunk;
+  long chunks;
+  long allocs;
+  long resets;
+} MemArena;
+
+static MemPool pools[MEM_KINDS][MEM_CLASSES];
+static MemArena arena;
+static long heap_bytes;
+
+char *mem_kind_name(int kind) {
+  switch (kind) {
+    case MEM_VAL: return "Val";
+    case MEM_ENV: return "Env";
+    case MEM_ERR: return "Err";
+  }
+  return "?";
+}
+
+int mem_class(size_t size) {
+  return (size + MEM_CLASS_BYTES - 1) / MEM_CLASS_BYTES - 1;
+}
+
+#ifdef MEM_POOL
+
+void mem_refill(MemPool *pool, size_t size) {
+  char *slab = malloc(MEM_SLAB_BYTES);
+  int n = MEM_SLAB_BYTES / size;
+  for (int i = n - 1; i >= 0; i--) {
+    MemNode *node = (MemNode*)(slab + i * size);
+    node->next = pool->free;
+    pool->free = node;
+  }
+  pool->slabs++;
+}
+
+void *mem_heap_alloc(int kind, size_t size) {
+  int c = mem_class(size);
+  if (c >= MEM_CLASSES) { return malloc(size); }
+
+  MemPool *pool = &pools[kind][c];
+  pool->allocs++;
+  pool->live++;
+  if (pool->free) {
+    pool->hits++;
+  } else {
+    mem_refill(pool, (c + 1) * MEM_CLASS_BYTES);
+  }
+
+  MemNode *node = pool->free;
+  pool->free = node->next;
+  return node;
+}
+
+void mem_heap_free(int kind, void *p, size_t size) {
+  int c = mem_class(size);
+  if (c >= MEM_CLASSES) { free(p); return; }
+
+  MemPool *pool = &pools[kind][c];
+  MemNode *node = p;
+  node->next = pool->free;
+  pool->free = node;
+  pool->live--;
+}
+
+#else
+
+void *mem_heap_alloc(int kind, size_t size) {
+  int c = mem_class(size);
+  if (c < MEM_CLASSES) {
+    pools[kind][c].allocs++;
+    pools[kind][c].live++;
+  }
+  return malloc(size);
+}
+
+void mem_heap_free(int kind, void *p, size_t size) {
+  int c = mem_class(size);
+  if (c < MEM_CLASSES) { pools[kind][c].live--; }
+  free(p);
+}
+
+#endif
+
+void *mem_arena_alloc(size_t size) {
+  size = (size + 7) & ~(size_t)7;
+  MemChunk *c = arena.chunk;
+  if (!c || c->used + size > c->size) {
+    /* chunks double so ownership checks stay short on huge lines */
+    size_t bytes = c ? c->size * 2 : MEM_CHUNK_BYTES;
+    while (bytes < size) { bytes *= 2; }
+    c = malloc(sizeof(MemChunk) + bytes);
+    c->prev = arena.chunk;
+    c->size = bytes;
+    c->used = 0;
+    arena.chunk = c;
+    arena.chunks++;
+  }
+  void *p = c->data + c->used;
+  c->used += size;
+  arena.allocs++;
+  return p;
+}
+
+int mem_arena_owns(void *p) {
+  for (MemChunk *c = arena.chunk; c; c = c->prev) {
+    if ((char*)p >= c->data && (char*)p < c->data + c->size) { return 1; }
+  }
+  return 0;
+}
+
+void *mem_alloc(int kind, size_t size) {
+  if (arena.active) { return mem_arena_alloc(size); }
+  heap_bytes += size;
+  return mem_heap_alloc(kind, size);
+}
+
+void mem_free(int kind, void *p, size_t size) {
+  if (arena.chunk && mem_arena_owns(p)) { return; }
+  heap_bytes -= size;
+  mem_heap_free(kind, p, size);
+}
+
+long mem_heap_bytes(void) {
+  return heap_bytes;
+}
+
+void mem_arena_begin(void) {
+#ifdef MEM_ARENA
+  arena.active = 1;
+#endif
+}
+
+void mem_arena_end(void) {
+  arena.active = 0;
+  if (!arena.chunk) { return; }
+
+  /* keep the newest (largest) chunk around for the next line */
+  MemChunk *c = arena.chunk->prev;
+  while (c) {
+    MemChunk *prev = c->prev;
+    free(c);
+    c = prev;
+  }
+  arena.chunk->prev = NULL;
+  arena.chunk->used = 0;
+  arena.resets++;
+}
+
+int mem_arena_pause(void) {
+  int active = arena.active;
+  arena.active = 0;
+  return active;
+}
+
+void mem_arena_resume(int active) {
+  arena.active = active;
+}
+
+void mem_print_stats(void) {
+#ifdef MEM_POOL
+  printf("allocator: pool, heap %li bytes\n", heap_bytes);
+#else
+  printf("allocator: system, heap %li bytes\n", heap_bytes);
+#endif
+  if (arena.resets || arena.chunk) {
+    printf(
+      "  arena: chunks %li, allocs %li, resets %li\n",
+      arena.chunks,
+      arena.allocs,
+      arena.resets
+    );
+  }
+  for (int k = 0; k < MEM_KINDS; k++) {
+    for (int c = 0; c < MEM_CLASSES; c++) {
+      MemPool *pool = &pools[k][c];
+      if (!pool->allocs) { continue; }
+      printf(
+        "  %s %3i bytes: live %li, allocs %li, slabs %li, hit rate %.1f%%\n",
+        mem_kind_name(k),
+        (c + 1) * MEM_CLASS_BYTES,
+        pool->live,
+        pool->allocs,
+        pool->slabs,
+        100.0 * pool->hits / pool->allocs
+      );
+    }
+  }
+}
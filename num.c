@@ -0,0 +1,400 @@
+/* num.c */
+
+#include "repl.h"
+
+/*
+ * integers that don't fit a fixnum are boxed VAL_NUMs holding a sign and
+ * a magnitude in base 2^32 digits, least significant first. results are
+ * always normalised (see big_norm), so a boxed number is never zero and
+ * never small enough to be a fixnum.
+ *
+ * the big_* operations borrow their arguments, which may be fixnums or
+ * boxed, and return a new number.
+ */
+
+#define BIG_BASE 4294967296UL
+
+/* a number's magnitude, with room to hold a fixnum's without allocating */
+typedef struct {
+  int sign;
+  int n;
+  uint32_t *d;
+  uint32_t buf[2];
+} BigArg;
+
+void big_arg(Val *v, BigArg *a) {
+  if (!val_is_fixnum(v)) {
+    a->sign = v->sign;
+    a->n = v->ndigits;
+    a->d = v->digits;
+    return;
+  }
+  long x = val_get_num(v);
+  unsigned long m = x < 0 ? -(unsigned long)x : (unsigned long)x;
+  a->sign = x < 0 ? -1 : 1;
+  a->buf[0] = (uint32_t)m;
+  a->buf[1] = (uint32_t)(m >> 32);
+  a->n = a->buf[1] ? 2 : a->buf[0] ? 1 : 0;
+  a->d = a->buf;
+}
+
+Val *big_new(int sign, int n) {
+  Val *v = val_new(VAL_NUM, val_size(digits));
+  v->sign = sign;
+  v->ndigits = n;
+  v->digits = calloc(n ? n : 1, sizeof(uint32_t));
+  return v;
+}
+
+/* trims leading zeros and turns anything in fixnum range back into one */
+Val *big_norm(Val *v) {
+  while (v->ndigits && !v->digits[v->ndigits - 1]) { v->ndigits--; }
+  if (v->ndigits > 2) { return v; }
+
+  unsigned long m = v->ndigits ? v->digits[0] : 0;
+  if (v->ndigits == 2) { m |= (unsigned long)v->digits[1] << 32; }
+  if (v->sign > 0 && m <= FIXNUM_MAX) {
+    val_del(v);
+    return val_fixnum(m);
+  }
+  if (v->sign < 0 && m <= -(unsigned long)FIXNUM_MIN) {
+    val_del(v);
+    return val_fixnum(-(long)m);
+  }
+  return v;
+}
+
+Val *big_from_long(long n) {
+  Val *v = big_new(n < 0 ? -1 : 1, 2);
+  unsigned long m = n < 0 ? -(unsigned long)n : (unsigned long)n;
+  v->digits[0] = (uint32_t)m;
+  v->digits[1] = (uint32_t)(m >> 32);
+  return big_norm(v);
+}
+
+/* the low 64 bits, for callers that only expect small numbers */
+long big_to_long(Val *v) {
+  unsigned long m = v->digits[0];
+  if (v->ndigits > 1) { m |= (unsigned long)v->digits[1] << 32; }
+  return v->sign < 0 ? (long)(0 - m) : (long)m;
+}
+
+/* nearest for anything under 2^53, then rounded once per digit */
+double big_to_double(Val *v) {
+  double d = 0;
+  for (int i = v->ndigits - 1; i >= 0; i--) {
+    d = d * (double)BIG_BASE + v->digits[i];
+  }
+  return v->sign * d;
+}
+
+int mag_cmp(BigArg *a, BigArg *b) {
+  if (a->n != b->n) { return a->n < b->n ? -1 : 1; }
+  for (int i = a->n - 1; i >= 0; i--) {
+    if (a->d[i] != b->d[i]) { return a->d[i] < b->d[i] ? -1 : 1; }
+  }
+  return 0;
+}
+
+/* |a| + |b|, with sign */
+Val *mag_add(BigArg *a, BigArg *b, int sign) {
+  if (a->n < b->n) { BigArg *t = a; a = b; b = t; }
+  Val *r = big_new(sign, a->n + 1);
+  uint64_t carry = 0;
+  for (int i = 0; i < a->n; i++) {
+    carry += (uint64_t)a->d[i] + (i < b->n ? b->d[i] : 0);
+    r->digits[i] = (uint32_t)carry;
+    carry >>= 32;
+  }
+  r->digits[a->n] = (uint32_t)carry;
+  return big_norm(r);
+}
+
+/* |a| - |b| where |a| >= |b|, with sign */
+Val *mag_sub(BigArg *a, BigArg *b, int sign) {
+  Val *r = big_new(sign, a->n);
+  int64_t borrow = 0;
+  for (int i = 0; i < a->n; i++) {
+    int64_t t = (int64_t)a->d[i] - (i < b->n ? b->d[i] : 0) - borrow;
+    borrow = t < 0;
+    r->digits[i] = (uint32_t)(t + (borrow ? BIG_BASE : 0));
+  }
+  return big_norm(r);
+}
+
+Val *big_signed_add(BigArg *a, BigArg *b) {
+  if (a->sign == b->sign) { return mag_add(a, b, a->sign); }
+  return mag_cmp(a, b) >= 0 ?
+    mag_sub(a, b, a->sign) :
+    mag_sub(b, a, b->sign);
+}
+
+Val *big_add(Val *x, Val *y) {
+  BigArg a, b;
+  big_arg(x, &a);
+  big_arg(y, &b);
+  return big_signed_add(&a, &b);
+}
+
+Val *big_sub(Val *x, Val *y) {
+  BigArg a, b;
+  big_arg(x, &a);
+  big_arg(y, &b);
+  b.sign = -b.sign;
+  return big_signed_add(&a, &b);
+}
+
+Val *big_neg(Val *x) {
+  return big_sub(val_fixnum(0), x);
+}
+
+/* schoolbook, which is linear when one side is a single word */
+Val *big_mul(Val *x, Val *y) {
+  BigArg a, b;
+  big_arg(x, &a);
+  big_arg(y, &b);
+  Val *r = big_new(a.sign * b.sign, a.n + b.n);
+  for (int i = 0; i < a.n; i++) {
+    uint64_t carry = 0;
+    for (int j = 0; j < b.n; j++) {
+      carry += (uint64_t)a.d[i] * b.d[j] + r->digits[i + j];
+      r->digits[i + j] = (uint32_t)carry;
+      carry >>= 32;
+    }
+    r->digits[i + b.n] = (uint32_t)carry;
+  }
+  return big_norm(r);
+}
+
+/*
+ * q = |a| / |b| and r = |a| % |b| for b != 0, by Knuth's algorithm D.
+ * q needs a->n digits and r needs b->n.
+ */
+void mag_divmod(BigArg *a, BigArg *b, uint32_t *q, uint32_t *r) {
+  int m = a->n;
+  int n = b->n;
+
+  if (n == 1) {
+    uint64_t rem = 0;
+    for (int i = m - 1; i >= 0; i--) {
+      uint64_t cur = (rem << 32) | a->d[i];
+      q[i] = (uint32_t)(cur / b->d[0]);
+      rem = cur % b->d[0];
+    }
+    r[0] = (uint32_t)rem;
+    return;
+  }
+
+  /* shift so the divisor's top digit has its high bit set */
+  int s = __builtin_clz(b->d[n - 1]);
+  uint32_t *vn = malloc(sizeof(uint32_t) * n);
+  uint32_t *un = malloc(sizeof(uint32_t) * (m + 1));
+  for (int i = n - 1; i > 0; i--) {
+    vn[i] = (uint32_t)(((uint64_t)b->d[i] << s) | ((uint64_t)b->d[i - 1] >> (32 - s)));
+  }
+  vn[0] = b->d[0] << s;
+  un[m] = (uint32_t)((uint64_t)a->d[m - 1] >> (32 - s));
+  for (int i = m - 1; i > 0; i--) {
+    un[i] = (uint32_t)(((uint64_t)a->d[i] << s) | ((uint64_t)a->d[i - 1] >> (32 - s)));
+  }
+  un[0] = a->d[0] << s;
+
+  for (int i = 0; i < m; i++) { q[i] = 0; }
+  for (int j = m - n; j >= 0; j--) {
+    uint64_t num = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+    uint64_t qhat = num / vn[n - 1];
+    uint64_t rhat = num % vn[n - 1];
+    while (
+      qhat >= BIG_BASE ||
+      qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])
+    ) {
+      qhat--;
+      rhat += vn[n - 1];
+      if (rhat >= BIG_BASE) { break; }
+    }
+
+    int64_t borrow = 0;
+    int64_t t;
+    for (int i = 0; i < n; i++) {
+      uint64_t p = qhat * vn[i];
+      t = (int64_t)un[i + j] - borrow - (int64_t)(p & 0xFFFFFFFF);
+      un[i + j] = (uint32_t)t;
+      borrow = (int64_t)(p >> 32) - (t >> 32);
+    }
+    t = (int64_t)un[j + n] - borrow;
+    un[j + n] = (uint32_t)t;
+
+    q[j] = (uint32_t)qhat;
+    /* qhat was one too big: add the divisor back */
+    if (t < 0) {
+      q[j]--;
+      uint64_t carry = 0;
+      for (int i = 0; i < n; i++) {
+        carry += (uint64_t)un[i + j] + vn[i];
+        un[i + j] = (uint32_t)carry;
+        carry >>= 32;
+      }
+      un[j + n] += (uint32_t)carry;
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    r[i] = (uint32_t)(((uint64_t)un[i] >> s) | ((uint64_t)un[i + 1] << (32 - s)));
+  }
+  free(vn);
+  free(un);
+}
+
+/* truncates toward zero, so the remainder takes the dividend's sign */
+Val *big_divmod(Val *x, Val *y, int want_mod) {
+  BigArg a, b;
+  big_arg(x, &a);
+  big_arg(y, &b);
+  if (mag_cmp(&a, &b) < 0) {
+    return want_mod ? val_ref(x) : val_fixnum(0);
+  }
+
+  Val *q = big_new(a.sign * b.sign, a.n);
+  Val *r = big_new(a.sign, b.n);
+  mag_divmod(&a, &b, q->digits, r->digits);
+  if (want_mod) {
+    val_del(q);
+    return big_norm(r);
+  }
+  val_del(r);
+  return big_norm(q);
+}
+
+Val *big_div(Val *x, Val *y) {
+  return big_divmod(x, y, 0);
+}
+
+Val *big_mod(Val *x, Val *y) {
+  return big_divmod(x, y, 1);
+}
+
+int big_cmp(Val *x, Val *y) {
+  BigArg a, b;
+  big_arg(x, &a);
+  big_arg(y, &b);
+  if (a.n == 0 && b.n == 0) { return 0; }
+  if (a.n == 0) { return -b.sign; }
+  if (b.n == 0) { return a.sign; }
+  if (a.sign != b.sign) { return a.sign; }
+  return a.sign * mag_cmp(&a, &b);
+}
+
+Val *big_min(Val *x, Val *y) {
+  return val_ref(big_cmp(y, x) < 0 ? y : x);
+}
+
+Val *big_max(Val *x, Val *y) {
+  return val_ref(big_cmp(y, x) > 0 ? y : x);
+}
+
+/* the len digits at s, with an optional leading '-' */
+Val *big_parse(char *s, int len) {
+  int sign = 1;
+  if (*s == '-') {
+    sign = -1;
+    s++;
+    len--;
+  }
+
+  /* each decimal digit needs under 4 bits */
+  Val *v = big_new(sign, len / 9 + 2);
+  int n = 0;
+  for (int i = 0; i < len; ) {
+    uint32_t chunk = 0;
+    uint32_t scale = 1;
+    for (int k = 0; k < 9 && i < len; k++, i++) {
+      chunk = chunk * 10 + (s[i] - '0');
+      scale *= 10;
+    }
+
+    uint64_t carry = chunk;
+    for (int j = 0; j < n; j++) {
+      carry += (uint64_t)v->digits[j] * scale;
+      v->digits[j] = (uint32_t)carry;
+      carry >>= 32;
+    }
+    if (carry) { v->digits[n++] = (uint32_t)carry; }
+  }
+  v->ndigits = n;
+  return big_norm(v);
+}
+
+/* peels off nine decimal digits at a time from a copy of the magnitude */
+void big_print(Val *v) {
+  BigArg a;
+  big_arg(v, &a);
+  uint32_t *d = malloc(sizeof(uint32_t) * a.n);
+  memcpy(d, a.d, sizeof(uint32_t) * a.n);
+  uint32_t *chunks = malloc(sizeof(uint32_t) * (a.n * 10 / 9 + 2));
+
+  int n = a.n;
+  int count = 0;
+  while (n) {
+    uint64_t rem = 0;
+    for (int i = n - 1; i >= 0; i--) {
+      uint64_t cur = (rem << 32) | d[i];
+      d[i] = (uint32_t)(cur / 1000000000);
+      rem = cur % 1000000000;
+    }
+    chunks[count++] = (uint32_t)rem;
+    while (n && !d[n - 1]) { n--; }
+  }
+
+  if (a.sign < 0) { putchar('-'); }
+  printf("%u", count ? chunks[count - 1] : 0);
+  for (int i = count - 2; i >= 0; i--) {
+    printf("%09u", chunks[i]);
+  }
+  free(d);
+  free(chunks);
+}
+
+/*
+ * floats are boxed VAL_DBLs. the sum and product below run four lanes at a
+ * time with gcc/clang vector extensions, which lower to whatever simd the
+ * target has (or to scalar code) without needing -march. summing in lanes
+ * reassociates, so + and * can differ from a left fold in the last bit.
+ * min and max have no kernel: a blend per lane lost to the scalar fold.
+ */
+
+typedef double DblVec __attribute__((vector_size(4 * sizeof(double))));
+
+#define DBL_LANES 4
+
+/* macros rather than functions, since passing vectors by value is abi-sensitive */
+#define DBL_LOAD(x) ({ DblVec v_; memcpy(&v_, (x), sizeof(v_)); v_; })
+
+/* each folds x into a, as the scalar loop in builtin_op would */
+double dbl_sum(double a, double *x, int n) {
+  DblVec acc = {a, 0, 0, 0};
+  int i = 0;
+  for (; i + DBL_LANES <= n; i += DBL_LANES) { acc += DBL_LOAD(x + i); }
+  double r = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+  for (; i < n; i++) { r += x[i]; }
+  return r;
+}
+
+double dbl_prod(double a, double *x, int n) {
+  DblVec acc = {a, 1, 1, 1};
+  int i = 0;
+  for (; i + DBL_LANES <= n; i += DBL_LANES) { acc *= DBL_LOAD(x + i); }
+  double r = (acc[0] * acc[1]) * (acc[2] * acc[3]);
+  for (; i < n; i++) { r *= x[i]; }
+  return r;
+}
+
+/* the shortest digits that read back the same, always with a point */
+void dbl_print(double d) {
+  char buf[32];
+  for (int p = 1; p <= 17; p++) {
+    snprintf(buf, sizeof(buf), "%.*g", p, d);
+    if (strtod(buf, NULL) == d) { break; }
+  }
+  fputs(buf, stdout);
+  if (isfinite(d) && !strpbrk(buf, ".e")) { fputs(".0", stdout); }
+}
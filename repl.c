@@ -6,153 +6,309 @@
  * Val builders
  */
 
+Val *val_new(int type, size_t size) {
+  Val *v = mem_alloc(MEM_VAL, size);
+  v->type = type;
+  v->refs = 1;
+  return v;
+}
+
+size_t val_alloc_size(Val *v) {
+  switch (val_type(v)) {
+    case VAL_NUM: return val_size(digits);
+    case VAL_DBL: return val_size(dbl);
+    case VAL_ERR: return val_size(err);
+    case VAL_SYM: return val_size(sym);
+    case VAL_FUNC: return v->func ? val_size(func) : val_size(fn_slot);
+  }
+  return val_size(base);
+}
+
 Val *val_num(long n) {
-  Val *v = malloc(sizeof(Val));
-  v->type = VAL_NUM;
-  v->num = n;
+  if (n >= FIXNUM_MIN && n <= FIXNUM_MAX) { return val_fixnum(n); }
+  return big_from_long(n);
+}
+
+Val *val_dbl(double d) {
+  Val *v = val_new(VAL_DBL, val_size(dbl));
+  v->dbl = d;
   return v;
 }
 
 Val *val_err(Err *err) {
-  Val *v = malloc(sizeof(Val));
-  v->type = VAL_ERR;
-  v->err = malloc(sizeof(Err));
-  v->err = err_copy(err);
-  err_del(err);
+  Val *v = val_new(VAL_ERR, val_size(err));
+  v->err = err;
   return v;
 }
 
 Val *val_sym(char *s) {
-  Val *v = malloc(sizeof(Val));
-  v->type = VAL_SYM;
-  v->sym = malloc(strlen(s) + 1);
-  strcpy(v->sym, s);
+  Val *v = val_new(VAL_SYM, val_size(sym));
+  v->sym = sym_intern(s);
   return v;
 }
 
 Val *val_func(BuiltIn func) {
-  Val *v = malloc(sizeof(Val));
-  v->type = VAL_FUNC;
+  Val *v = val_new(VAL_FUNC, val_size(func));
   v->func = func;
   return v;
 }
 
 Val *val_lambda(Val *args, Val *body) {
-  Val *v = malloc(sizeof(Val));
-  v->type = VAL_FUNC;
+  Val *v = val_new(VAL_FUNC, val_size(fn_slot));
   v->func = NULL;
   v->env = env_new();
   v->args = args;
   v->body = body;
-  return v;
+  v->code = NULL;
+  return gc_track(v);
 }
 
 Val *val_sexpr(void) {
-  Val *v = malloc(sizeof(Val));
-  v->type = VAL_SEXPR;
+  Val *v = val_new(VAL_SEXPR, val_size(base));
   v->count = 0;
+  v->capacity = 0;
   v->cell = NULL;
-  return v;
+  v->base = NULL;
+  return gc_track(v);
 }
 
 Val *val_qexpr(void) {
-  Val *v = malloc(sizeof(Val));
-  v->type = VAL_QEXPR;
+  Val *v = val_new(VAL_QEXPR, val_size(base));
   v->count = 0;
+  v->capacity = 0;
   v->cell = NULL;
-  return v;
+  v->base = NULL;
+  return gc_track(v);
 }
 
 /*
  * Val operators
  */
 
-void val_del(Val *v) {
-  switch (v->type) {
-    case VAL_NUM: break;
+/* releases everything v refers to, leaving a shell for val_free */
+void val_clear(Val *v) {
+  switch (val_type(v)) {
     case VAL_FUNC:
       if (!v->func) {
         env_del(v->env);
         val_del(v->args);
         val_del(v->body);
+        if (v->code) { code_del(v->code); }
+        v->code = NULL;
       }
       break;
-    case VAL_ERR: free(v->err); break;
-    case VAL_SYM: free(v->sym); break;
     case VAL_SEXPR:
     case VAL_QEXPR:
-      for (int i = 0; i < v->count; i++) {
-        val_del(v->cell[i]);
+      if (v->base) {
+        val_del(v->base);
+        v->base = NULL;
+        v->cell = NULL;
+      } else {
+        for (int i = 0; i < v->count; i++) {
+          val_del(v->cell[i]);
+        }
       }
-      free(v->cell);
+      v->count = 0;
       break;
   }
+}
+
+void val_free(Val *v) {
+  switch (val_type(v)) {
+    case VAL_NUM: free(v->digits); break;
+    case VAL_ERR: err_del(v->err); break;
+    case VAL_SEXPR:
+    case VAL_QEXPR: free(v->cell); break;
+  }
 
-  free(v);
+  gc_untrack(v);
+  mem_free(MEM_VAL, v, val_alloc_size(v));
 }
 
+/*
+ * copies only the outer value; its children are shared with v. a copy of
+ * a view owns its cells.
+ */
 Val *val_copy(Val *v) {
-  Val *c = malloc(sizeof(Val));
-  c->type = v->type;
+  if (val_is_fixnum(v)) { return v; }
 
-  switch (v->type) {
-    case VAL_NUM: c->num = v->num; break;
+  switch (val_type(v)) {
+    case VAL_NUM: {
+      Val *c = big_new(v->sign, v->ndigits);
+      memcpy(c->digits, v->digits, sizeof(uint32_t) * v->ndigits);
+      return c;
+    }
+    case VAL_DBL:
+      return val_dbl(v->dbl);
     case VAL_FUNC:
-      if (v->func) {
-        c->func = v->func;
-      } else {
-        c->func = NULL;
-        c->env = env_copy(v->env);
-        c->args = val_copy(v->args);
-        c->body = val_copy(v->body);
-      }
-      break;
-    case VAL_ERR:
+      if (v->func) { return val_func(v->func); }
+      Val *f = val_new(VAL_FUNC, val_size(fn_slot));
+      f->func = NULL;
+      f->env = env_copy(v->env);
+      f->args = val_ref(v->args);
+      f->body = val_ref(v->body);
+      f->code = NULL;
+      return gc_track(f);
+    case VAL_ERR: {
+      Val *c = val_new(VAL_ERR, val_size(err));
       c->err = err_copy(v->err);
-      break;
-    case VAL_SYM:
-      c->sym = malloc(strlen(v->sym) + 1);
-      strcpy(c->sym, v->sym);
+      return c;
+    }
+    case VAL_SYM: {
+      Val *c = val_new(VAL_SYM, val_size(sym));
+      c->sym = v->sym;
+      return c;
+    }
+  }
+
+  Val *c = val_new(val_type(v), val_size(base));
+  c->count = v->count;
+  c->capacity = v->count;
+  c->cell = malloc(sizeof(Val*) * c->capacity);
+  c->base = NULL;
+  for (int i = 0; i < c->count; i++) {
+    c->cell[i] = val_ref(v->cell[i]);
+  }
+  return gc_track(c);
+}
+
+/* takes v and returns a value with the same contents that only the caller holds */
+Val *val_unshare(Val *v) {
+  if (val_is_fixnum(v) || (v->refs == 1 && !val_is_view(v))) { return v; }
+  Val *c = val_copy(v);
+  val_del(v);
+  return c;
+}
+
+/* swaps *p for a copy outside the arena, reusing whatever is already there */
+void val_promote_at(Val **p) {
+  Val *c = val_promote(*p);
+  val_del(*p);
+  *p = c;
+}
+
+Val *val_promote(Val *v) {
+  if (val_is_fixnum(v) || !mem_arena_owns(v)) { return val_ref(v); }
+
+  int active = mem_arena_pause();
+  Val *c = val_copy(v);
+  switch (val_type(c)) {
+    case VAL_FUNC:
+      if (c->func) { break; }
+      for (int i = 0; i < c->env->count; i++) {
+        val_promote_at(&c->env->vals[i]);
+      }
+      val_promote_at(&c->args);
+      val_promote_at(&c->body);
       break;
     case VAL_SEXPR:
     case VAL_QEXPR:
-      c->count = v->count;
-      c->cell = malloc(sizeof(Val*) * c->count);
       for (int i = 0; i < c->count; i++) {
-        c->cell[i] = val_copy(v->cell[i]);
+        val_promote_at(&c->cell[i]);
       }
-    break;
+      break;
   }
-
+  mem_arena_resume(active);
   return c;
 }
 
+void val_resize(Val *v, int capacity) {
+  v->capacity = capacity;
+  v->cell = realloc(v->cell, sizeof(Val*) * capacity);
+}
+
+/* makes room for n cells without reallocating on each append */
+void val_reserve(Val *v, int n) {
+  if (n <= v->capacity) { return; }
+  int capacity = v->capacity ? v->capacity : VAL_MIN_CAPACITY;
+  while (capacity < n) { capacity *= 2; }
+  val_resize(v, capacity);
+}
+
 Val *val_append(Val *v, Val *c) {
-  v->count++;
-  v->cell = realloc(v->cell, sizeof(Val*) * v->count);
-  v->cell[v->count - 1] = c;
+  val_reserve(v, v->count + 1);
+  v->cell[v->count++] = c;
   return v;
 }
 
+/* halve only well below capacity, so pop/append at the edge doesn't thrash */
+void val_shrink(Val *v) {
+  while (
+    v->capacity > VAL_MIN_CAPACITY &&
+    v->count < v->capacity / VAL_SHRINK_RATIO
+  ) {
+    val_resize(v, v->capacity / 2);
+  }
+}
+
 Val *val_pop(Val *v, int i) {
   Val *c = v->cell[i];
-  memmove(&v->cell[i], &v->cell[i+1], sizeof(Val*) * v->count - i - 1);
+  memmove(&v->cell[i], &v->cell[i+1], sizeof(Val*) * (v->count - i - 1));
   v->count--;
-  v->cell = realloc(v->cell, sizeof(Val*) * v->count);
+  val_shrink(v);
   return c;
 }
 
+/* deletes n cells starting at i, moving the rest down once */
+void val_drop(Val *v, int i, int n) {
+  if (n == 0) { return; }
+  for (int j = i; j < i + n; j++) {
+    val_del(v->cell[j]);
+  }
+  memmove(&v->cell[i], &v->cell[i+n], sizeof(Val*) * (v->count - i - n));
+  v->count -= n;
+  val_shrink(v);
+}
+
+/*
+ * takes v and returns a view of n of its cells from i, sharing them
+ * rather than copying. views of views share the original.
+ */
+Val *val_slice(Val *v, int i, int n) {
+  Val *s = v->type == VAL_SEXPR ? val_sexpr() : val_qexpr();
+  s->base = v->base ? val_ref(v->base) : val_ref(v);
+  s->cell = v->cell + i;
+  s->count = n;
+  val_del(v);
+  return s;
+}
+
 Val *val_take(Val *v, int i) {
   Val *c = val_pop(v, i);
   val_del(v);
   return c;
 }
 
-Val *val_join(Val *a, Val *b) {
-  while (b->count) {
-    a = val_append(a, val_pop(b, 0));
+/* deletes every cell from n on */
+void val_truncate(Val *v, int n) {
+  val_drop(v, n, v->count - n);
+}
+
+/*
+ * takes b and inserts its cells into a at i, moving them in one go. b's
+ * cells are moved if only the caller holds b, or shared if not.
+ */
+void val_splice(Val *a, int i, Val *b) {
+  if (b->count == 0) {
+    val_del(b);
+    return;
+  }
+  val_reserve(a, a->count + b->count);
+  memmove(&a->cell[i + b->count], &a->cell[i], sizeof(Val*) * (a->count - i));
+  memcpy(&a->cell[i], b->cell, sizeof(Val*) * b->count);
+  a->count += b->count;
+
+  if (b->refs == 1 && !val_is_view(b)) {
+    b->count = 0;
+  } else {
+    for (int j = 0; j < b->count; j++) { val_ref(b->cell[j]); }
   }
   val_del(b);
+}
+
+Val *val_join(Val *a, Val *b) {
+  a = val_unshare(a);
+  val_splice(a, a->count, b);
   return a;
 }
 
@@ -160,38 +316,96 @@ Val *val_join(Val *a, Val *b) {
  * Val readers
  */
 
-Val *val_read_num(mpc_ast_t *t) {
+/*
+ * the reader scans the input text directly, following the grammar in
+ * main. symbols are interned from slices of the text, so nothing is
+ * copied and no parse tree is built. it returns NULL at a syntax error,
+ * and process_input asks mpc to describe it.
+ */
+
+int read_is_sym(char c) {
+  return c && (isalnum((unsigned char)c) || strchr("_+-*/\\=<>!&%", c));
+}
+
+int read_is_num(char *s) {
+  return isdigit((unsigned char)s[0]) ||
+    (s[0] == '-' && isdigit((unsigned char)s[1]));
+}
+
+/* digits '.' digits as in the grammar, copied so strtod can't read an exponent */
+Val *val_read_dbl(char **s) {
+  char *start = *s;
+  char *end = start + (*start == '-');
+  while (isdigit((unsigned char)*end)) { end++; }
+  for (end++; isdigit((unsigned char)*end); end++) {}
+
+  char buf[64];
+  int len = end - start;
+  char *text = len < (int)sizeof(buf) ? buf : malloc(len + 1);
+  memcpy(text, start, len);
+  text[len] = '\0';
+  double d = strtod(text, NULL);
+  if (text != buf) { free(text); }
+
+  *s = end;
+  return val_dbl(d);
+}
+
+Val *val_read_num(char **s) {
+  char *start = *s;
+  char *p = start + (*start == '-');
+  while (isdigit((unsigned char)*p)) { p++; }
+  if (p[0] == '.' && isdigit((unsigned char)p[1])) { return val_read_dbl(s); }
+
   errno = 0;
-  long n = strtol(t->contents, NULL, 10);
-  return errno == ERANGE ?
-    val_err(err_parse_number(t->contents)) :
-    val_num(n);
-}
-
-int skip_append(mpc_ast_t *t) {
-  return (
-    strcmp(t->contents, "(") == 0 ||
-    strcmp(t->contents, ")") == 0 ||
-    strcmp(t->contents, "{") == 0 ||
-    strcmp(t->contents, "}") == 0 ||
-    strcmp(t->tag, "regex") == 0
-  );
+  long n = strtol(start, s, 10);
+  return errno == ERANGE ? big_parse(start, *s - start) : val_num(n);
 }
 
-Val *val_read(mpc_ast_t *t) {
-  if (strstr(t->tag, "number")) { return val_read_num(t); }
-  if (strstr(t->tag, "symbol")) { return val_sym(t->contents); }
+Val *val_read_sym(char **s) {
+  char *start = *s;
+  while (read_is_sym(**s)) { (*s)++; }
+  Val *v = val_new(VAL_SYM, val_size(sym));
+  v->sym = sym_intern_len(start, *s - start);
+  return v;
+}
 
-  Val *root = NULL;
-  if (strcmp(t->tag, ">") == 0) { root = val_sexpr(); }
-  if (strstr(t->tag, "sexpr")) { root = val_sexpr(); }
-  if (strstr(t->tag, "qexpr")) { root = val_qexpr(); }
+Val *val_read_expr(char **s);
 
-  for (int i=0; i < t->children_num; i++) {
-    if (skip_append(t->children[i])) { continue; }
-    root = val_append(root, val_read(t->children[i]));
+/* reads exprs into v until close, which is '\0' at the top level */
+Val *val_read_cells(Val *v, char **s, char close) {
+  while (1) {
+    while (isspace((unsigned char)**s)) { (*s)++; }
+    if (**s == close) {
+      if (close) { (*s)++; }
+      return v;
+    }
+    Val *c = val_read_expr(s);
+    if (!c) {
+      val_del(v);
+      return NULL;
+    }
+    val_append(v, c);
+  }
+}
+
+Val *val_read_expr(char **s) {
+  char c = **s;
+  if (c == '(') {
+    (*s)++;
+    return val_read_cells(val_sexpr(), s, ')');
+  }
+  if (c == '{') {
+    (*s)++;
+    return val_read_cells(val_qexpr(), s, '}');
   }
-  return root;
+  if (read_is_num(*s)) { return val_read_num(s); }
+  if (read_is_sym(c)) { return val_read_sym(s); }
+  return NULL;
+}
+
+Val *val_read(char *input) {
+  return val_read_cells(val_sexpr(), &input, '\0');
 }
 
 /*
@@ -210,9 +424,16 @@ void val_expr_print(Val *v, char open, char close) {
 }
 
 void val_print(Val *v) {
-  switch (v->type) {
+  switch (val_type(v)) {
     case VAL_NUM:
-      printf("%li", v->num);
+      if (val_is_fixnum(v)) {
+        printf("%li", val_get_num(v));
+      } else {
+        big_print(v);
+      }
+      break;
+    case VAL_DBL:
+      dbl_print(v->dbl);
       break;
     case VAL_SYM:
       printf("%s", v->sym);
@@ -235,7 +456,7 @@ void val_print(Val *v) {
       val_expr_print(v, '{', '}');
       break;
     case VAL_ERR:
-      printf("**%s**: %s", v->err->name, v->err->det);
+      printf("**%s**: %s", v->err->name, err_det(v->err));
       break;
   }
 }
@@ -258,15 +479,26 @@ void env_add_builtins(Env *e) {
   env_add_builtin(e, "min", builtin_min);
   env_add_builtin(e, "max", builtin_max);
 
+  env_add_builtin(e, "==", builtin_eq);
+  env_add_builtin(e, "!=", builtin_ne);
+  env_add_builtin(e, "<", builtin_lt);
+  env_add_builtin(e, ">", builtin_gt);
+  env_add_builtin(e, "<=", builtin_le);
+  env_add_builtin(e, ">=", builtin_ge);
+
   env_add_builtin(e, "list", builtin_list);
   env_add_builtin(e, "head", builtin_head);
   env_add_builtin(e, "tail", builtin_tail);
   env_add_builtin(e, "eval", builtin_eval);
+  env_add_builtin(e, "if", builtin_if);
   env_add_builtin(e, "join", builtin_join);
 
   env_add_builtin(e, "def", builtin_def);
   env_add_builtin(e, "\\", builtin_lambda);
   env_add_builtin(e, ":=", builtin_assign);
+
+  env_add_builtin(e, "stats", builtin_stats);
+  env_add_builtin(e, "gc", builtin_gc);
 }
 
 Env *env_init(void) {
@@ -286,16 +518,26 @@ int should_exit(char *input) {
 }
 
 void process_input(Env *e, char *input, mpc_parser_t *lisp) {
-  mpc_result_t r;
-  if (mpc_parse("<stdin>", input, lisp, &r)) {
-    // mpc_ast_print(r.output);
-    Val *v = val_eval(e, val_read(r.output));
-    val_println(v);
-    val_del(v);
-  } else {
-    mpc_err_print(r.error);
-    mpc_err_delete(r.error);
+  mem_arena_begin();
+  Val *x = val_read(input);
+  if (!x) {
+    mem_arena_end();
+    /* only a syntax error goes through mpc, for its error message */
+    mpc_result_t r;
+    if (mpc_parse("<stdin>", input, lisp, &r)) {
+      mpc_ast_delete(r.output);
+    } else {
+      mpc_err_print(r.error);
+      mpc_err_delete(r.error);
+    }
+    return;
   }
+
+  Val *v = val_eval(e, x);
+  val_println(v);
+  val_del(v);
+  mem_arena_end();
+  gc_safepoint(e);
 }
 
 int main(int argc, char **argv) {
@@ -309,7 +551,7 @@ int main(int argc, char **argv) {
   mpca_lang(
     MPCA_LANG_DEFAULT,
     "                                                         \
-      number    : /-?[0-9]+/ ;                                \
+      number    : /-?[0-9]+(\\.[0-9]+)?/ ;                   \
       symbol    : /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&%]+/ ;         \
       sexpr     : '(' <expr>* ')' ;                           \
       qexpr     : '{' <expr>* '}' ;                           \
@@ -324,6 +566,13 @@ int main(int argc, char **argv) {
     ItsLisp
   );
 
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--vm") == 0) { eval_vm = 1; }
+    if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+      vm_max_depth = atoi(argv[++i]);
+    }
+  }
+
   startup_info();
 
   Env *env = env_init();
@@ -4,6 +4,11 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
+#include <math.h>
 
 #include <editline/readline.h>
 #include "mpc.h"
@@ -19,35 +24,157 @@ typedef struct Env Env;
 struct Err;
 typedef struct Err Err;
 
+struct Code;
+typedef struct Code Code;
+
+struct NumOp;
+typedef struct NumOp NumOp;
+
 typedef Val*(*BuiltIn)(Env*, Val*);
 
+/*
+ * only the members for a value's type are allocated, so a Val must never
+ * be read through a member of another type (see val_size)
+ *
+ * values are shared by reference count; anything that changes a Val in
+ * place must own it outright first (see val_unshare)
+ */
 struct Val {
   int type;
+  int refs;
 
-  long num;
-  char *sym;
-  Err *err;
+  union {
+    /* a boxed number is a bignum (see num.c) */
+    struct {
+      int sign;
+      int ndigits;
+      uint32_t *digits;
+    };
 
-  BuiltIn func;
-  Env *env;
-  Val *args;
-  Val *body;
+    double dbl;
+    char *sym;
+    Err *err;
 
-  int count;
-  Val **cell;
+    struct {
+      BuiltIn func;
+      Env *env;
+      Val *args;
+      Val *body;
+      Code *code;
+      int fn_slot;
+    };
+
+    /*
+     * a view shares a range of base's cells instead of owning its own:
+     * cell points into base->cell and capacity is 0 (see val_slice)
+     */
+    struct {
+      int count;
+      int capacity;
+      int slot;
+      Val **cell;
+      Val *base;
+    };
+  };
 };
 
+/* cell arrays shrink once count falls below capacity / VAL_SHRINK_RATIO */
+#define VAL_MIN_CAPACITY 4
+#define VAL_SHRINK_RATIO 4
+
+/* bytes needed for a Val whose last used member is `member` */
+#define val_size(member) \
+  (offsetof(Val, member) + sizeof(((Val*)0)->member))
+
+/*
+ * syms are interned (see sym_intern). frames with more than
+ * ENV_LINEAR_MAX bindings also get an open-addressing index from sym to
+ * position; small ones, like most lambda frames, are just scanned.
+ *
+ * a call frame's bound is the lambda's own env, holding what it captured
+ * when it was made and the arguments of earlier partial applications.
+ * it's searched after the frame's bindings and before its parent, the
+ * global env, and is shared with the lambda rather than copied.
+ */
+#define ENV_LINEAR_MAX 8
+
 struct Env {
   Env *parent;
+  Env *bound;
   int count;
+  int capacity;
   char **syms;
   Val **vals;
+  int *index;
+  int buckets;
 };
 
+/*
+ * a global's value, good while env_version is still version, and the
+ * builtin it is, if any
+ */
+typedef struct {
+  long version;
+  Val *val;
+  BuiltIn func;
+} GlobalCache;
+
+/*
+ * a compiled s-expression (see vm.c), allocated in one piece. ops are
+ * opcodes followed by their operands; consts holds a reference to every
+ * value the code pushes or looks up. depth is the most values it ever
+ * has on the vm stack. code that runs only once hands its consts over
+ * instead of sharing them.
+ *
+ * a lambda body's params is how many arguments bind straight from the
+ * stack, or -1 when its parameters take a rest list.
+ *
+ * subs, beside consts, caches the code for a const q-expression once it
+ * is run by eval or if. code is shared by its lambda, the code it is a
+ * sub of, and any run in progress; refs counts them.
+ *
+ * fn is the lambda whose body the code is part of, which its symbols are
+ * resolved against (see vm_resolve). it's borrowed: code only runs, and
+ * compiles its subs, while its lambda is alive. local_defs is set when
+ * its body could def a name into the frame.
+ *
+ * globals, also beside consts, is the inline cache of each global the
+ * code looks up. the values aren't references: a definition that could
+ * change one bumps env_version first.
+ */
+struct Code {
+  int *ops;
+  int count;
+  Val **consts;
+  Code **subs;
+  GlobalCache *globals;
+  Val *fn;
+  int local_defs;
+  int nconsts;
+  int depth;
+  int once;
+  int params;
+  int refs;
+};
+
+/*
+ * name is static; det is too when fixed, and is owned by the Err
+ * otherwise. a lazy Err keeps fmt and its arguments, and only renders
+ * det when something asks for it (see err_det). string arguments are
+ * borrowed, so they must outlive the Err.
+ */
+typedef union {
+  long i;
+  char *s;
+} ErrArg;
+
 struct Err {
   int type;
+  int fixed;
   char *name;
   char *det;
+  char *fmt;
+  ErrArg args[3];
 };
 
 enum {
@@ -56,7 +183,8 @@ enum {
   VAL_SYM,
   VAL_FUNC,
   VAL_SEXPR,
-  VAL_QEXPR
+  VAL_QEXPR,
+  VAL_DBL
 };
 
 enum {
@@ -67,10 +195,138 @@ enum {
   ERR_STANDARD,
 };
 
+enum {
+  MEM_VAL,
+  MEM_ENV,
+  MEM_ERR,
+  MEM_KINDS
+};
+
+/*
+ * numbers that fit in 63 bits are immediates: the value lives in the
+ * pointer itself, tagged by the low bit, and is never allocated or freed
+ */
+
+#define FIXNUM_MAX (LONG_MAX >> 1)
+#define FIXNUM_MIN (LONG_MIN >> 1)
+
+static inline int val_is_fixnum(Val *v) {
+  return (uintptr_t)v & 1;
+}
+
+static inline Val *val_fixnum(long n) {
+  return (Val*)(((uintptr_t)n << 1) | 1);
+}
+
+/* Val accessors */
+
+static inline int val_type(Val *v) {
+  return val_is_fixnum(v) ? VAL_NUM : v->type;
+}
+
+long big_to_long(Val *v);
+double big_to_double(Val *v);
+
+static inline long val_get_num(Val *v) {
+  return val_is_fixnum(v) ? (intptr_t)v >> 1 : big_to_long(v);
+}
+
+/* any number, as a double */
+static inline double val_get_dbl(Val *v) {
+  if (val_is_fixnum(v)) { return (double)val_get_num(v); }
+  return v->type == VAL_DBL ? v->dbl : big_to_double(v);
+}
+
+static inline int val_is_view(Val *v) {
+  int t = val_type(v);
+  return (t == VAL_SEXPR || t == VAL_QEXPR) && v->base;
+}
+
+void val_clear(Val *v);
+void val_free(Val *v);
+
+/* nearly every step of evaluation counts references, so these inline */
+static inline Val *val_ref(Val *v) {
+  if (!val_is_fixnum(v)) { v->refs++; }
+  return v;
+}
+
+static inline void val_del(Val *v) {
+  if (val_is_fixnum(v)) { return; }
+  if (--v->refs > 0) { return; }
+  val_clear(v);
+  val_free(v);
+}
+
+/* Mem functions */
+
+void *mem_alloc(int kind, size_t size);
+void mem_free(int kind, void *p, size_t size);
+void mem_print_stats(void);
+long mem_heap_bytes(void);
+void mem_arena_begin(void);
+void mem_arena_end(void);
+int mem_arena_owns(void *p);
+int mem_arena_pause(void);
+void mem_arena_resume(int active);
+
+/* Num functions */
+
+Val *big_new(int sign, int n);
+Val *big_from_long(long n);
+Val *big_parse(char *s, int len);
+Val *big_add(Val *x, Val *y);
+Val *big_sub(Val *x, Val *y);
+Val *big_neg(Val *x);
+Val *big_mul(Val *x, Val *y);
+Val *big_div(Val *x, Val *y);
+Val *big_mod(Val *x, Val *y);
+int big_cmp(Val *x, Val *y);
+Val *big_min(Val *x, Val *y);
+Val *big_max(Val *x, Val *y);
+void big_print(Val *v);
+double dbl_sum(double a, double *x, int n);
+double dbl_prod(double a, double *x, int n);
+void dbl_print(double d);
+
+/* Vm functions */
+
+extern int eval_vm;
+extern long env_version;
+extern int vm_max_depth;
+
+Code *vm_compile(Val *v, Val *fn);
+void code_del(Code *c);
+Val *vm_run(Env *e, Code *c);
+Val *vm_eval(Env *e, Val *v);
+Val *vm_call(Env *e, Val *f);
+int vm_stack_depth(void);
+Val *vm_stack_fn(int i);
+void vm_print_stack(void);
+void vm_print_stats(void);
+
+/* Sym functions */
+
+char *sym_intern(char *s);
+char *sym_intern_len(char *s, int len);
+
+/* Gc functions */
+
+Val *gc_track(Val *v);
+void gc_untrack(Val *v);
+int *gc_slot(Val *v);
+long gc_collect(Env *root);
+void gc_safepoint(Env *root);
+void gc_set_threshold(long bytes);
+void gc_print_stats(void);
+
 /* Val functions */
 
-Val *val_read(mpc_ast_t *t);
+Val *val_read(char *input);
+Val *val_new(int type, size_t size);
+size_t val_alloc_size(Val *v);
 Val *val_num(long n);
+Val *val_dbl(double d);
 Val *val_sym(char *s);
 Val *val_func(BuiltIn func);
 Val *val_lambda(Val *args, Val *body);
@@ -78,13 +334,29 @@ Val *val_err(Err *err);
 Val *val_sexpr(void);
 Val *val_qexpr(void);
 Val *val_copy(Val *v);
+Val *val_unshare(Val *v);
+Val *val_promote(Val *v);
 Val *val_pop(Val *v, int i);
+void val_drop(Val *v, int i, int n);
+void val_truncate(Val *v, int n);
+void val_splice(Val *a, int i, Val *b);
+Val *val_slice(Val *v, int i, int n);
 Val *val_take(Val *v, int i);
+void val_reserve(Val *v, int n);
 Val *val_append(Val *v, Val *c);
 Val *val_join(Val *a, Val *b);
-void val_del(Val *v);
 Val *val_eval(Env *e, Val *v);
 Val *val_call(Env *e, Val *f, Val *v);
+Val *val_call_tail(Env *e, Val *f, Val *v, Val **q, Env **frame);
+Val *val_eval_qexpr(Env *e, Val *q);
+Val *eval_branch(Val *args, Val **q);
+Val *if_branch(Val *args, Val **q);
+void eval_print_stats(void);
+char *type_name(int t);
+NumOp *num_op(BuiltIn f);
+Val *num_fold(NumOp *op, Val **cell, int count);
+int cmp_op(BuiltIn f);
+Val *num_compare(int mask, Val **cell, int count);
 void val_print(Val *v);
 void val_println(Val *v);
 
@@ -94,9 +366,14 @@ Env *env_new(void);
 Env *env_init(void);
 Env *env_copy(Env *e);
 void env_del(Env *e);
+void env_clear(Env *e);
+int env_find(Env *e, char *sym);
 Val *env_get(Env *e, Val *k);
+Env *env_root(Env *e);
 void env_def(Env *e, Val *k, Val *v);
 void env_put(Env *e, Val *k, Val *v);
+void env_bind(Env *e, char *sym, Val *v);
+void env_push(Env *e, char *sym, Val *v);
 void env_add_builtin(Env *e, char *name, BuiltIn func);
 
 /* builtin functions */
@@ -105,6 +382,7 @@ Val *builtin_head(Env *e, Val *args);
 Val *builtin_tail(Env *e, Val *args);
 Val *builtin_list(Env *e, Val *args);
 Val *builtin_eval(Env *e, Val *args);
+Val *builtin_if(Env *e, Val *args);
 Val *builtin_join(Env *e, Val *args);
 Val *builtin_def(Env *e, Val *v);
 Val *builtin_assign(Env *e, Val *v);
@@ -116,14 +394,24 @@ Val *builtin_div(Env *e, Val *v);
 Val *builtin_mod(Env *e, Val *v);
 Val *builtin_min(Env *e, Val *v);
 Val *builtin_max(Env *e, Val *v);
+Val *builtin_lt(Env *e, Val *v);
+Val *builtin_le(Env *e, Val *v);
+Val *builtin_gt(Env *e, Val *v);
+Val *builtin_ge(Env *e, Val *v);
+Val *builtin_eq(Env *e, Val *v);
+Val *builtin_ne(Env *e, Val *v);
+Val *builtin_stats(Env *e, Val *v);
+Val *builtin_gc(Env *e, Val *v);
 
 /* Err functions */
 
 char *err_name(int e);
 Err *err_new(int type, char *fmt, ...);
+Err *err_fixed(int type, char *det);
+Err *err_lazy(int type, char *fmt);
+char *err_det(Err *e);
 Err *err_copy(Err *e);
 void err_del(Err *e);
-Err *err_parse_number(char *given);
 Err *err_unbound_symbol(char *given);
 Err *err_arg_type(char *expected, char *given);
 Err *err_cell_arg_type(int index, char *expected, char *given);
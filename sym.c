@@ -0,0 +1,62 @@
+/* sym.c */
+
+#include "repl.h"
+
+/*
+ * every symbol name is stored once, here, and never freed. a VAL_SYM and
+ * an env key hold the interned pointer, so two symbols are the same
+ * exactly when their pointers are equal.
+ */
+
+typedef struct {
+  char **names;
+  int count;
+  int capacity;
+} SymTable;
+
+static SymTable table;
+
+unsigned long sym_hash(char *s, int len) {
+  unsigned long h = 14695981039346656037UL;
+  for (int i = 0; i < len; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211UL;
+  }
+  return h;
+}
+
+void sym_grow(void) {
+  int capacity = table.capacity ? table.capacity * 2 : 256;
+  char **names = calloc(capacity, sizeof(char*));
+  for (int i = 0; i < table.capacity; i++) {
+    if (!table.names[i]) { continue; }
+    unsigned long j = sym_hash(table.names[i], strlen(table.names[i])) & (capacity - 1);
+    while (names[j]) { j = (j + 1) & (capacity - 1); }
+    names[j] = table.names[i];
+  }
+  free(table.names);
+  table.names = names;
+  table.capacity = capacity;
+}
+
+char *sym_intern(char *s) {
+  return sym_intern_len(s, strlen(s));
+}
+
+/* interns the len chars at s, which needn't be terminated */
+char *sym_intern_len(char *s, int len) {
+  if (2 * (table.count + 1) > table.capacity) { sym_grow(); }
+
+  unsigned long i = sym_hash(s, len) & (table.capacity - 1);
+  while (table.names[i]) {
+    char *name = table.names[i];
+    if (strncmp(name, s, len) == 0 && name[len] == '\0') { return name; }
+    i = (i + 1) & (table.capacity - 1);
+  }
+
+  table.names[i] = malloc(len + 1);
+  memcpy(table.names[i], s, len);
+  table.names[i][len] = '\0';
+  table.count++;
+  return table.names[i];
+}
@@ -26,3 +26,44 @@ Val* build_qexpr(int arg_count, ...) {
 
   return qexpr;
 }
+
+int diff_mode = 0;
+int diff_failures = 0;
+
+/* what val_print writes for v, in a string the caller frees */
+char *print_to_str(Val *v) {
+  char *buf = NULL;
+  size_t size = 0;
+  FILE *out = stdout;
+  fflush(out);
+  stdout = open_memstream(&buf, &size);
+  val_print(v);
+  fclose(stdout);
+  stdout = out;
+  return buf;
+}
+
+/*
+ * val_eval, except that in diff_mode v runs on the tree-walker and then
+ * on the vm, and the two must print the same. the vm's result is returned.
+ */
+Val* diff_eval(Env *e, Val *v) {
+  if (!diff_mode) { return val_eval(e, v); }
+
+  eval_vm = 0;
+  Val *walk = val_eval(e, val_copy(v));
+  eval_vm = 1;
+  Val *vm = val_eval(e, v);
+  eval_vm = 0;
+
+  char *a = print_to_str(walk);
+  char *b = print_to_str(vm);
+  if (strcmp(a, b) != 0) {
+    printf("\n  ***walker printed `%s`, vm printed `%s`***", a, b);
+    diff_failures++;
+  }
+  free(a);
+  free(b);
+  val_del(walk);
+  return vm;
+}
@@ -17,8 +17,8 @@
 } while (0)
 
 #define run_test(test) do { \
-  int result = test(); \
-  if (!result) { return result; } \
+  int result = test() && !diff_failures; \
+  if (!result) { return 0; } \
   printf(": pass\n"); \
 } while (0)
 
@@ -37,6 +37,10 @@
 Val *build_sexpr(int arg_count, ...);
 Val *build_qexpr(int arg_count, ...);
 
+extern int diff_mode;
+extern int diff_failures;
+Val *diff_eval(Env *e, Val *v);
+
 int error_tests(void);
 int error_tests_run;
 
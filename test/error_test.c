@@ -8,11 +8,11 @@ int error_tests_run = 0;
 int test_division_by_zero(char *sym) {
   Env *env = env_init();
   Val *expr = build_sexpr(3, s(sym), n(3), n(0));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_ARITHMETIC);
-  assert_detail(result->err->det, "division by zero");
+  assert_detail(err_det(result->err), "division by zero");
 
   val_del(result);
   env_del(env);
@@ -32,11 +32,11 @@ int test_mod_by_zero(void) {
 
 int test_builtin_op_wrong_type(Env *env, Val *val, char *det) {
   Val *expr = build_sexpr(3, s("+"), n(2), val);
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, det);
+  assert_detail(err_det(result->err), det);
 
   val_del(result);
 
@@ -78,11 +78,11 @@ int test_eval_sexpr_func_error(void) {
   begin_test;
   Env *env = env_init();
   Val *expr = build_sexpr(2, n(2), n(3));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, "expected function at index 0, got number");
+  assert_detail(err_det(result->err), "expected function at index 0, got number");
 
   val_del(result);
   env_del(env);
@@ -90,14 +90,66 @@ int test_eval_sexpr_func_error(void) {
   return 1;
 }
 
+/* (+ x (def {y} 1)) with x unbound never gets as far as the def */
+int test_eval_sexpr_stops_at_error(void) {
+  begin_test;
+  Env *env = env_init();
+  Val *def = build_sexpr(3, s("def"), build_qexpr(1, s("y")), n(1));
+  Val *expr = build_sexpr(3, s("+"), s("x"), def);
+  Val *result = diff_eval(env, expr);
+
+  assert_type(val_type(result), VAL_ERR);
+  assert_detail(err_det(result->err), "unbound symbol: x");
+  val_del(result);
+
+  result = diff_eval(env, s("y"));
+  assert_type(val_type(result), VAL_ERR);
+  assert_detail(err_det(result->err), "unbound symbol: y");
+
+  val_del(result);
+  env_del(env);
+
+  return 1;
+}
+
+/* the vm's calls are on the heap, so it stops at its limit rather than crashing */
+int test_vm_stack_depth_exceeded(void) {
+  begin_test;
+  Env *env = env_init();
+  int vm_was = eval_vm;
+  int max_was = vm_max_depth;
+  eval_vm = 1;
+  vm_max_depth = 100;
+
+  val_del(val_eval(env, val_read(
+    "def {sum} (\\ {n} {if (== n 0) {0} {+ n (sum (- n 1))}})"
+  )));
+  Val *result = val_eval(env, val_read("sum 200"));
+  assert_type(val_type(result), VAL_ERR);
+  assert_err_type(result->err->type, ERR_STANDARD);
+  assert_detail(err_det(result->err), "stack depth exceeded");
+  assert_count(vm_stack_depth(), 0);
+  val_del(result);
+
+  result = val_eval(env, val_read("sum 50"));
+  assert_num(val_get_num(result), 1275);
+  val_del(result);
+
+  vm_max_depth = max_was;
+  eval_vm = vm_was;
+  env_del(env);
+
+  return 1;
+}
+
 int test_too_many_args(char *sym) {
   Env *env = env_init();
   Val *expr = build_sexpr(3, s(sym), build_qexpr(1, n(2)), n(3));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_ARG);
-  assert_detail(result->err->det, "expected 1 arguments, got 2");
+  assert_detail(err_det(result->err), "expected 1 arguments, got 2");
 
   val_del(result);
   env_del(env);
@@ -123,11 +175,11 @@ int test_eval_too_many_args(void) {
 int test_expected_qexpr(char *sym) {
   Env *env = env_init();
   Val *expr = build_sexpr(2, s(sym), n(3));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, "expected q-expression at index 0, got number");
+  assert_detail(err_det(result->err), "expected q-expression at index 0, got number");
 
   val_del(result);
   env_del(env);
@@ -153,11 +205,11 @@ int test_eval_wrong_type(void) {
 int test_empty_qexpr(char *sym) {
   Env *env = env_init();
   Val *expr = build_sexpr(2, s(sym), val_qexpr());
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_type(result->err->type, ERR_ARG);
-  assert_detail(result->err->det, "expected some arguments at index 0, got 0");
+  assert_detail(err_det(result->err), "expected some arguments at index 0, got 0");
 
   val_del(result);
   env_del(env);
@@ -184,11 +236,11 @@ int test_join_wrong_type_0(void) {
     build_qexpr(1, n(2)),
     build_qexpr(1, n(2))
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, "expected q-expression at index 0, got number");
+  assert_detail(err_det(result->err), "expected q-expression at index 0, got number");
 
   val_del(result);
   env_del(env);
@@ -205,11 +257,11 @@ int test_join_wrong_type_1(void) {
     n(5),
     build_qexpr(1, n(2))
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, "expected q-expression at index 1, got number");
+  assert_detail(err_det(result->err), "expected q-expression at index 1, got number");
 
   val_del(result);
   env_del(env);
@@ -226,11 +278,11 @@ int test_join_wrong_type_2(void) {
     build_qexpr(1, n(2)),
     n(5)
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, "expected q-expression at index 2, got number");
+  assert_detail(err_det(result->err), "expected q-expression at index 2, got number");
 
   val_del(result);
   env_del(env);
@@ -238,13 +290,48 @@ int test_join_wrong_type_2(void) {
   return 1;
 }
 
+int test_join_no_args(void) {
+  begin_test;
+  Env *env = env_init();
+  /* (join) evaluates to join itself, so call it with no arguments directly */
+  Val *result = builtin_join(env, val_sexpr());
+
+  assert_type(val_type(result), VAL_ERR);
+  assert_err_type(result->err->type, ERR_ARG);
+  assert_detail(err_det(result->err), "expected some arguments, got 0");
+
+  val_del(result);
+  env_del(env);
+
+  return 1;
+}
+
+/* a bignum threshold would be truncated, and a negative one is meaningless */
+int test_gc_bad_threshold(void) {
+  begin_test;
+  Env *env = env_init();
+  char *inputs[] = {"gc -5", "gc 99999999999999999999"};
+  for (int i = 0; i < 2; i++) {
+    Val *result = diff_eval(env, val_read(inputs[i]));
+
+    assert_type(val_type(result), VAL_ERR);
+    assert_err_type(result->err->type, ERR_VALUE);
+    assert_detail(err_det(result->err), "expected a non-negative fixnum threshold");
+
+    val_del(result);
+  }
+  env_del(env);
+
+  return 1;
+}
+
 int test_def_arg0_wrong_type(Env *env, Val *val, char *detail) {
   Val *expr = build_sexpr(2, s("def"), val);
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, detail);
+  assert_detail(err_det(result->err), detail);
 
   val_del(result);
   env_del(env);
@@ -297,11 +384,11 @@ int test_def_arg0_sexpr(void) {
 int test_def_arg1_wrong_type(Val *val, char *detail) {
   Env *env = env_init();
   Val *expr = build_sexpr(2, s("def"), build_qexpr(3, s("x"), s("y"), val));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, detail);
+  assert_detail(err_det(result->err), detail);
 
   val_del(result);
   env_del(env);
@@ -341,11 +428,11 @@ int test_def_wrong_arg_count(void) {
     build_qexpr(2, s("x"), s("y")),
     n(2)
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_ARG);
-  assert_detail(result->err->det, "expected 1 arguments, got 2");
+  assert_detail(err_det(result->err), "expected 3 arguments, got 2");
 
   val_del(result);
   env_del(env);
@@ -360,11 +447,11 @@ int test_lambda_wrong_arg_count_1(void) {
     s("\\"),
     build_qexpr(2, s("x"), s("y"))
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_ARG);
-  assert_detail(result->err->det, "expected 2 arguments, got 1");
+  assert_detail(err_det(result->err), "expected 2 arguments, got 1");
 
   val_del(result);
   env_del(env);
@@ -381,11 +468,11 @@ int test_lambda_wrong_arg_count_3(void) {
     build_qexpr(3, s("+"), s("x"), s("y")),
     build_qexpr(1, s("x"))
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_ARG);
-  assert_detail(result->err->det, "expected 2 arguments, got 3");
+  assert_detail(err_det(result->err), "expected 2 arguments, got 3");
 
   val_del(result);
   env_del(env);
@@ -399,11 +486,11 @@ int test_lambda_wrong_arg0_type(Env *env, Val *val, char *detail) {
     val,
     build_qexpr(3, s("+"), s("x"), s("y"))
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, detail);
+  assert_detail(err_det(result->err), detail);
 
   val_del(result);
   env_del(env);
@@ -459,11 +546,11 @@ int test_lambda_wrong_arg1_type(Env *env, Val *val, char *detail) {
     build_qexpr(2, s("x"), s("y")),
     val
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, detail);
+  assert_detail(err_det(result->err), detail);
 
   val_del(result);
   env_del(env);
@@ -520,11 +607,11 @@ int test_lambda_wrong_arg0_inner_type(Val *val, char *detail) {
     build_qexpr(2, s("x"), val),
     build_qexpr(3, s("+"), s("x"), s("y"))
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_ERR);
+  assert_type(val_type(result), VAL_ERR);
   assert_err_type(result->err->type, ERR_TYPE);
-  assert_detail(result->err->det, detail);
+  assert_detail(err_det(result->err), detail);
 
   val_del(result);
   env_del(env);
@@ -565,6 +652,8 @@ int error_tests(void) {
   run_test(test_builtin_op_with_qexpr_error);
 
   run_test(test_eval_sexpr_func_error);
+  run_test(test_eval_sexpr_stops_at_error);
+  run_test(test_vm_stack_depth_exceeded);
 
   run_test(test_head_too_many_args);
   run_test(test_head_wrong_type);
@@ -580,6 +669,8 @@ int error_tests(void) {
   run_test(test_join_wrong_type_0);
   run_test(test_join_wrong_type_1);
   run_test(test_join_wrong_type_2);
+  run_test(test_join_no_args);
+  run_test(test_gc_bad_threshold);
 
   run_test(test_def_arg0_number);
   run_test(test_def_arg0_symbol);
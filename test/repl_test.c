@@ -15,10 +15,10 @@ int test_arithmetic(void) {
   Val *twenty_two = build_sexpr(3, s("-"), twenty_six, n(4));
   Val *expr = build_sexpr(3, s("%"), twenty_two, n(5));
 
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_NUM);
-  assert_num(result->num, 2);
+  assert_type(val_type(result), VAL_NUM);
+  assert_num(val_get_num(result), 2);
 
   val_del(result);
   env_del(env);
@@ -30,10 +30,10 @@ int test_min(void) {
   begin_test;
   Env *env = env_init();
   Val *expr = build_sexpr(5, s("min"), n(3), n(2), n(7), n(5));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_NUM);
-  assert_num(result->num, 2);
+  assert_type(val_type(result), VAL_NUM);
+  assert_num(val_get_num(result), 2);
 
   val_del(result);
   env_del(env);
@@ -45,10 +45,10 @@ int test_max(void) {
   begin_test;
   Env *env = env_init();
   Val *expr = build_sexpr(5, s("max"), n(3), n(2), n(7), n(5));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_NUM);
-  assert_num(result->num, 7);
+  assert_type(val_type(result), VAL_NUM);
+  assert_num(val_get_num(result), 7);
 
   val_del(result);
   env_del(env);
@@ -63,10 +63,10 @@ int test_head(void) {
   Val *expr = build_sexpr(2, s("eval"), head);
 
   Env *env = env_init();
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_NUM);
-  assert_num(result->num, 2);
+  assert_type(val_type(result), VAL_NUM);
+  assert_num(val_get_num(result), 2);
 
   val_del(result);
   env_del(env);
@@ -78,18 +78,18 @@ int test_tail(void) {
   begin_test;
   Env *env = env_init();
   Val *expr = build_sexpr(2, s("tail"), build_qexpr(4, n(2), n(3), n(5), s("x")));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_QEXPR);
+  assert_type(val_type(result), VAL_QEXPR);
   assert_count(result->count, 3);
 
-  assert_type(result->cell[0]->type, VAL_NUM);
-  assert_num(result->cell[0]->num, 3);
+  assert_type(val_type(result->cell[0]), VAL_NUM);
+  assert_num(val_get_num(result->cell[0]), 3);
 
-  assert_type(result->cell[1]->type, VAL_NUM);
-  assert_num(result->cell[1]->num, 5);
+  assert_type(val_type(result->cell[1]), VAL_NUM);
+  assert_num(val_get_num(result->cell[1]), 5);
 
-  assert_type(result->cell[2]->type, VAL_SYM);
+  assert_type(val_type(result->cell[2]), VAL_SYM);
   assert_sym(result->cell[2]->sym, "x");
 
   val_del(result);
@@ -103,19 +103,19 @@ int test_list(void) {
   Env *env = env_init();
 
   Val *expr = build_sexpr(4, s("list"), n(2), n(3), n(5));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_QEXPR);
+  assert_type(val_type(result), VAL_QEXPR);
   assert_count(result->count, 3);
 
-  assert_type(result->cell[0]->type, VAL_NUM);
-  assert_num(result->cell[0]->num, 2);
+  assert_type(val_type(result->cell[0]), VAL_NUM);
+  assert_num(val_get_num(result->cell[0]), 2);
 
-  assert_type(result->cell[1]->type, VAL_NUM);
-  assert_num(result->cell[1]->num, 3);
+  assert_type(val_type(result->cell[1]), VAL_NUM);
+  assert_num(val_get_num(result->cell[1]), 3);
 
-  assert_type(result->cell[2]->type, VAL_NUM);
-  assert_num(result->cell[2]->num, 5);
+  assert_type(val_type(result->cell[2]), VAL_NUM);
+  assert_num(val_get_num(result->cell[2]), 5);
 
   val_del(result);
   env_del(env);
@@ -132,22 +132,22 @@ int test_join(void) {
     build_qexpr(2, n(2), n(3)),
     build_qexpr(2, n(3), n(5))
   );
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_QEXPR);
+  assert_type(val_type(result), VAL_QEXPR);
   assert_count(result->count, 4);
 
-  assert_type(result->cell[0]->type, VAL_NUM);
-  assert_num(result->cell[0]->num, 2);
+  assert_type(val_type(result->cell[0]), VAL_NUM);
+  assert_num(val_get_num(result->cell[0]), 2);
 
-  assert_type(result->cell[1]->type, VAL_NUM);
-  assert_num(result->cell[1]->num, 3);
+  assert_type(val_type(result->cell[1]), VAL_NUM);
+  assert_num(val_get_num(result->cell[1]), 3);
 
-  assert_type(result->cell[2]->type, VAL_NUM);
-  assert_num(result->cell[2]->num, 3);
+  assert_type(val_type(result->cell[2]), VAL_NUM);
+  assert_num(val_get_num(result->cell[2]), 3);
 
-  assert_type(result->cell[3]->type, VAL_NUM);
-  assert_num(result->cell[3]->num, 5);
+  assert_type(val_type(result->cell[3]), VAL_NUM);
+  assert_num(val_get_num(result->cell[3]), 5);
 
   val_del(result);
   env_del(env);
@@ -167,15 +167,14 @@ int test_def(void) {
     build_qexpr(1, s("x")),
     n(2)
   );
-  val_eval(env, def);
+  val_del(diff_eval(env, def));
 
   Val *expr = build_sexpr(3, s("+"), s("x"), n(3));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_NUM);
-  assert_num(result->num, 5);
+  assert_type(val_type(result), VAL_NUM);
+  assert_num(val_get_num(result), 5);
 
-  val_del(def);
   val_del(result);
   env_del(env);
 
@@ -193,10 +192,10 @@ int test_lambda(void) {
   );
 
   Val *expr = build_sexpr(2, lambda, n(3));
-  Val *result = val_eval(env, expr);
+  Val *result = diff_eval(env, expr);
 
-  assert_type(result->type, VAL_NUM);
-  assert_num(result->num, 9);
+  assert_type(val_type(result), VAL_NUM);
+  assert_num(val_get_num(result), 9);
 
   val_del(result);
   env_del(env);
@@ -204,24 +203,548 @@ int test_lambda(void) {
   return 1;
 }
 
+int test_lambda_rest_args(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *lambda = build_sexpr(3,
+    s("\\"),
+    build_qexpr(3, s("x"), s("&"), s("xs")),
+    build_qexpr(3, s("join"), s("xs"), build_qexpr(1, s("x")))
+  );
+
+  Val *expr = build_sexpr(5, lambda, n(1), n(2), n(3), n(4));
+  Val *result = diff_eval(env, expr);
+
+  assert_type(val_type(result), VAL_QEXPR);
+  assert_count(result->count, 4);
+  assert_num(val_get_num(result->cell[0]), 2);
+  assert_num(val_get_num(result->cell[2]), 4);
+  assert_sym(result->cell[3]->sym, "x");
+
+  val_del(result);
+  env_del(env);
+
+  return 1;
+}
+
+int test_partial_application(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *lambda = build_sexpr(3,
+    s("\\"),
+    build_qexpr(3, s("a"), s("b"), s("c")),
+    build_qexpr(4, s("-"), s("a"), s("b"), s("c"))
+  );
+  val_del(diff_eval(env, build_sexpr(3, s("def"), build_qexpr(1, s("f")), lambda)));
+  val_del(diff_eval(env, build_sexpr(3, s("def"), build_qexpr(1, s("g")), build_sexpr(2, s("f"), n(10)))));
+
+  Val *x = diff_eval(env, build_sexpr(3, s("g"), n(2), n(3)));
+  Val *y = diff_eval(env, build_sexpr(2, build_sexpr(2, s("g"), n(4)), n(5)));
+  assert_num(val_get_num(x), 5);
+  assert_num(val_get_num(y), 1);
+
+  Val *g = diff_eval(env, s("g"));
+  assert_count(g->args->count, 2);
+  assert_count(g->env->count, 1);
+
+  val_del(x);
+  val_del(y);
+  val_del(g);
+  env_del(env);
+
+  return 1;
+}
+
+int test_if_and_compare(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *r = diff_eval(env, val_read("list (< 1 2) (>= 1 2) (== 2 2.0) (!= 1 1) (<= 0.5 1)"));
+  assert_count(r->count, 5);
+  assert_num(val_get_num(r->cell[0]), 1);
+  assert_num(val_get_num(r->cell[1]), 0);
+  assert_num(val_get_num(r->cell[2]), 1);
+  assert_num(val_get_num(r->cell[3]), 0);
+  assert_num(val_get_num(r->cell[4]), 1);
+  val_del(r);
+
+  r = diff_eval(env, val_read("if (> 99999999999999999999 1) {+ 1 2} {x}"));
+  assert_num(val_get_num(r), 3);
+  val_del(r);
+
+  r = diff_eval(env, val_read("if 0 {x} {}"));
+  assert_type(val_type(r), VAL_SEXPR);
+  assert_count(r->count, 0);
+  val_del(r);
+
+  env_del(env);
+
+  return 1;
+}
+
+/* deeper than the C stack could go if each call took a frame of it */
+int test_tail_calls(void) {
+  begin_test;
+  Env *env = env_init();
+
+  val_del(diff_eval(env, val_read(
+    "def {count} (\\ {n a} {if (== n 0) {a} {count (- n 1) (+ a 1)}})"
+  )));
+  Val *r = diff_eval(env, val_read("count 10000000 0"));
+  assert_type(val_type(r), VAL_NUM);
+  assert_num(val_get_num(r), 10000000);
+  val_del(r);
+
+  val_del(diff_eval(env, val_read(
+    "def {even odd} (\\ {n} {if (== n 0) {1} {odd (- n 1)}}) "
+    "(\\ {n} {if (== n 0) {0} {even (- n 1)}})"
+  )));
+  r = diff_eval(env, val_read("even 1000001"));
+  assert_num(val_get_num(r), 0);
+  val_del(r);
+
+  env_del(env);
+
+  return 1;
+}
+
+int test_lexical_scope(void) {
+  begin_test;
+  Env *env = env_init();
+
+  /* a lambda made in a call keeps what it uses from that call */
+  val_del(diff_eval(env, val_read("def {adder} (\\ {x} {\\ {y} {+ x y}})")));
+  val_del(diff_eval(env, val_read("def {x} 50")));
+  Val *r = diff_eval(env, val_read("(adder 1) 2"));
+  assert_num(val_get_num(r), 3);
+  val_del(r);
+
+  /* and a callee sees the globals, not its caller's params */
+  val_del(diff_eval(env, val_read("def {f} (\\ {_} {z})")));
+  val_del(diff_eval(env, val_read("def {g} (\\ {z} {f 0})")));
+  r = diff_eval(env, val_read("g 1"));
+  assert_type(val_type(r), VAL_ERR);
+  assert_detail(err_det(r->err), "unbound symbol: z");
+  val_del(r);
+
+  val_del(diff_eval(env, val_read("def {z} 7")));
+  r = diff_eval(env, val_read("g 1"));
+  assert_num(val_get_num(r), 7);
+  val_del(r);
+
+  env_del(env);
+
+  return 1;
+}
+
+/* far deeper than the C stack allows, now that the vm's calls are on the heap */
+int test_deep_recursion(void) {
+  begin_test;
+  Env *env = env_init();
+  int vm_was = eval_vm;
+  int max_was = vm_max_depth;
+  eval_vm = 1;
+  vm_max_depth = 1000000;
+
+  val_del(val_eval(env, val_read(
+    "def {sum} (\\ {n} {if (== n 0) {0} {+ n (sum (- n 1))}})"
+  )));
+  Val *r = val_eval(env, val_read("sum 300000"));
+  assert_num(val_get_num(r), 45000150000);
+  val_del(r);
+
+  vm_max_depth = max_was;
+  eval_vm = vm_was;
+  env_del(env);
+
+  return 1;
+}
+
+/* on the vm, globals are cached per lookup until something is defined */
+int test_redefined_global(void) {
+  begin_test;
+  Env *env = env_init();
+
+  val_del(diff_eval(env, val_read("def {scale} 2")));
+  val_del(diff_eval(env, val_read("def {f} (\\ {x} {* scale x})")));
+  Val *r = diff_eval(env, val_read("+ (f 1) (f 2)"));
+  assert_num(val_get_num(r), 6);
+  val_del(r);
+
+  val_del(diff_eval(env, val_read("def {scale} 10")));
+  r = diff_eval(env, val_read("f 3"));
+  assert_num(val_get_num(r), 30);
+  val_del(r);
+
+  val_del(diff_eval(env, val_read("def {*} +")));
+  r = diff_eval(env, val_read("f 3"));
+  assert_num(val_get_num(r), 13);
+  val_del(r);
+
+  env_del(env);
+
+  return 1;
+}
+
+/* the vm's quick builtin calls give way to the full ones off fixnums */
+int test_builtin_calls(void) {
+  begin_test;
+  Env *env = env_init();
+
+  val_del(diff_eval(env, val_read("def {inc} (\\ {x} {+ x 1})")));
+  val_del(diff_eval(env, val_read("def {sq} (\\ {x} {* x x})")));
+  val_del(diff_eval(env, val_read("def {sign} (\\ {x} {if (< x 0) {-1} {1}})")));
+
+  Val *r = diff_eval(env, val_read("inc 41"));
+  assert_num(val_get_num(r), 42);
+  val_del(r);
+  r = diff_eval(env, val_read("inc 2.5"));
+  assert_type(val_type(r), VAL_DBL);
+  val_del(r);
+  r = diff_eval(env, val_read("inc 4611686018427387903"));
+  assert_eq_int(val_is_fixnum(r), 0, "fixnum");
+  val_del(r);
+  r = diff_eval(env, val_read("sq 3037000500"));
+  assert_type(val_type(r), VAL_NUM);
+  assert_eq_int(val_is_fixnum(r), 0, "fixnum");
+  val_del(r);
+
+  r = diff_eval(env, val_read("sign -3"));
+  assert_num(val_get_num(r), -1);
+  val_del(r);
+  r = diff_eval(env, val_read("sign 2.5"));
+  assert_num(val_get_num(r), 1);
+  val_del(r);
+  r = diff_eval(env, val_read("sign {a}"));
+  assert_type(val_type(r), VAL_ERR);
+  val_del(r);
+
+  val_del(diff_eval(env, val_read("def {<} >")));
+  r = diff_eval(env, val_read("sign -3"));
+  assert_num(val_get_num(r), 1);
+  val_del(r);
+  val_del(diff_eval(env, val_read("def {if} (\\ {c a b} {c})")));
+  r = diff_eval(env, val_read("sign -3"));
+  assert_num(val_get_num(r), 0);
+  val_del(r);
+
+  env_del(env);
+
+  return 1;
+}
+
+int test_arena_promotion(void) {
+  begin_test;
+  Env *env = env_init();
+
+  mem_arena_begin();
+  Val *def = build_sexpr(4,
+    s("def"),
+    build_qexpr(2, s("x"), s("f")),
+    build_qexpr(2, n(2), s("y")),
+    build_sexpr(3,
+      s("\\"),
+      build_qexpr(1, s("z")),
+      build_qexpr(3, s("+"), s("z"), n(1))
+    )
+  );
+  val_del(diff_eval(env, def));
+  mem_arena_end();
+
+  mem_arena_begin();
+  Val *head = build_sexpr(2, s("head"), s("x"));
+  Val *expr = build_sexpr(2, s("f"), build_sexpr(2, s("eval"), head));
+  Val *result = diff_eval(env, expr);
+  mem_arena_end();
+
+  assert_type(val_type(result), VAL_NUM);
+  assert_num(val_get_num(result), 3);
+
+  env_del(env);
+
+  return 1;
+}
+
+int test_shared_values_unchanged(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *def = build_sexpr(4,
+    s("def"),
+    build_qexpr(2, s("x"), s("add")),
+    build_qexpr(3, n(2), n(3), n(5)),
+    build_sexpr(3,
+      s("\\"),
+      build_qexpr(2, s("a"), s("b")),
+      build_qexpr(3, s("+"), s("a"), s("b"))
+    )
+  );
+  val_del(diff_eval(env, def));
+
+  val_del(diff_eval(env, build_sexpr(2, s("tail"), s("x"))));
+  val_del(diff_eval(env, build_sexpr(2, s("head"), s("x"))));
+  val_del(diff_eval(env, build_sexpr(3, s("join"), s("x"), s("x"))));
+  val_del(diff_eval(env, build_sexpr(2, s("add"), n(1))));
+  val_del(diff_eval(env, build_sexpr(3, s("add"), n(1), n(2))));
+
+  Val *x = diff_eval(env, s("x"));
+  assert_type(val_type(x), VAL_QEXPR);
+  assert_count(x->count, 3);
+  assert_num(val_get_num(x->cell[0]), 2);
+  assert_num(val_get_num(x->cell[2]), 5);
+
+  Val *add = diff_eval(env, s("add"));
+  assert_count(add->args->count, 2);
+  assert_count(add->env->count, 0);
+
+  val_del(x);
+  val_del(add);
+  env_del(env);
+
+  return 1;
+}
+
+/* gc reports what it freed, which a second run wouldn't find, so no diff_eval */
+int test_gc_collects_cycles(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *def = build_sexpr(3, s("def"), build_qexpr(1, s("x")), build_qexpr(2, n(2), n(3)));
+  val_del(val_eval(env, def));
+
+  val_del(val_eval(env, build_sexpr(2, s("gc"), n(0))));
+
+  Val *cycle = build_qexpr(1, build_qexpr(1, n(5)));
+  val_append(cycle->cell[0], val_ref(cycle));
+  val_del(cycle);
+
+  Val *result = val_eval(env, build_sexpr(2, s("gc"), n(0)));
+  assert_num(val_get_num(result), 2);
+
+  Val *x = val_eval(env, s("x"));
+  assert_count(x->count, 2);
+  assert_num(val_get_num(x->cell[1]), 3);
+
+  val_del(x);
+  env_del(env);
+
+  return 1;
+}
+
+int test_env_many_bindings(void) {
+  begin_test;
+  Env *env = env_init();
+
+  char name[16];
+  for (int i = 0; i < 100; i++) {
+    snprintf(name, sizeof(name), "g%i", i);
+    val_del(diff_eval(env, build_sexpr(3, s("def"), build_qexpr(1, s(name)), n(i))));
+  }
+  val_del(diff_eval(env, build_sexpr(3, s("def"), build_qexpr(1, s("g42")), n(-42))));
+
+  Val *x = diff_eval(env, s("g42"));
+  assert_num(val_get_num(x), -42);
+  Val *y = diff_eval(env, s("g99"));
+  assert_num(val_get_num(y), 99);
+  Val *add = diff_eval(env, s("+"));
+  assert_type(val_type(add), VAL_FUNC);
+
+  val_del(x);
+  val_del(y);
+  val_del(add);
+  env_del(env);
+
+  return 1;
+}
+
+int test_cells_grow_and_shrink(void) {
+  begin_test;
+  Val *v = val_qexpr();
+  for (int i = 0; i < 1000; i++) {
+    val_append(v, n(i));
+  }
+  assert_count(v->count, 1000);
+  assert_count(v->capacity, 1024);
+
+  while (v->count > 10) {
+    val_del(val_pop(v, v->count - 1));
+  }
+  assert_count(v->capacity, 32);
+  assert_num(val_get_num(v->cell[9]), 9);
+
+  val_del(v);
+
+  return 1;
+}
+
+int test_tail_shares_cells(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *def = build_sexpr(3, s("def"), build_qexpr(1, s("x")), build_qexpr(4, n(1), n(2), n(3), n(4)));
+  val_del(diff_eval(env, def));
+
+  Val *x = diff_eval(env, s("x"));
+  Val *t = diff_eval(env, build_sexpr(2, s("tail"), build_sexpr(2, s("tail"), s("x"))));
+  assert_count(t->count, 2);
+  assert_eq_int(t->base == x, 1, "base");
+  assert_eq_int(t->cell == x->cell + 2, 1, "cell");
+
+  Val *redef = build_sexpr(3, s("def"), build_qexpr(1, s("x")), n(0));
+  val_del(diff_eval(env, redef));
+  val_del(x);
+  val_del(diff_eval(env, build_sexpr(2, s("gc"), n(0))));
+
+  assert_num(val_get_num(t->cell[0]), 3);
+  assert_num(val_get_num(t->cell[1]), 4);
+
+  val_del(t);
+  env_del(env);
+
+  return 1;
+}
+
+int test_read(void) {
+  begin_test;
+  char src[] = " (def {x} {1 -2 foo-1 (+ 3)}) foo ";
+  Val *v = val_read(src);
+
+  assert_type(val_type(v), VAL_SEXPR);
+  assert_count(v->count, 2);
+  Val *x = v->cell[0]->cell[2];
+  assert_type(val_type(x), VAL_QEXPR);
+  assert_count(x->count, 4);
+  assert_num(val_get_num(x->cell[1]), -2);
+  assert_sym(x->cell[2]->sym, "foo-1");
+  assert_count(x->cell[3]->count, 2);
+  assert_eq_int(v->cell[1]->sym == sym_intern("foo"), 1, "interned");
+
+  val_del(v);
+  assert_eq_int(val_read("(+ 1 {2)") == NULL, 1, "syntax error");
+
+  return 1;
+}
+
+int test_bignums(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *big = diff_eval(env, build_sexpr(4, s("*"), n(FIXNUM_MAX), n(FIXNUM_MAX), n(-4)));
+  assert_type(val_type(big), VAL_NUM);
+  assert_eq_int(val_is_fixnum(big), 0, "fixnum");
+  assert_eq_int(big->sign, -1, "sign");
+  assert_count(big->ndigits, 4);
+
+  Val *x = diff_eval(env, build_sexpr(4, s("/"), big, n(FIXNUM_MAX), n(-4)));
+  assert_eq_int(val_is_fixnum(x), 1, "fixnum");
+  assert_num(val_get_num(x), FIXNUM_MAX);
+
+  Val *y = val_take(val_read("-123456789012345678901234567890"), 0);
+  Val *r = diff_eval(env, build_sexpr(3, s("%"), y, n(1000000007)));
+  assert_num(val_get_num(r), -197434842);
+
+  val_del(x);
+  val_del(r);
+  env_del(env);
+
+  return 1;
+}
+
+int test_floats(void) {
+  begin_test;
+  Env *env = env_init();
+
+  Val *x = val_take(val_read("-1.25"), 0);
+  assert_type(val_type(x), VAL_DBL);
+  assert_eq_int(x->dbl == -1.25, 1, "dbl");
+
+  Val *r = diff_eval(env, build_sexpr(3, s("+"), n(2), x));
+  assert_type(val_type(r), VAL_DBL);
+  assert_eq_int(r->dbl == 0.75, 1, "dbl");
+  val_del(r);
+
+  /* enough floats to go through the vector sum and its tail, and max beside it */
+  Val *sum = build_sexpr(1, s("+"));
+  Val *max = build_sexpr(1, s("max"));
+  for (int i = 0; i < 103; i++) {
+    val_append(sum, val_dbl(0.5));
+    val_append(max, val_dbl(i == 70 ? 1e9 : i * 0.25));
+  }
+  r = diff_eval(env, sum);
+  assert_eq_int(r->dbl == 51.5, 1, "dbl");
+  val_del(r);
+  r = diff_eval(env, max);
+  assert_eq_int(r->dbl == 1e9, 1, "dbl");
+  val_del(r);
+
+  r = diff_eval(env, build_sexpr(3, s("/"), val_dbl(1.5), n(0)));
+  assert_type(val_type(r), VAL_ERR);
+  assert_detail(err_det(r->err), "division by zero");
+  val_del(r);
+
+  env_del(env);
+
+  return 1;
+}
+
 int all_tests(void) {
+  run_test(test_read);
   run_test(test_arithmetic);
   run_test(test_min);
   run_test(test_max);
+  run_test(test_bignums);
+  run_test(test_floats);
   run_test(test_head);
   run_test(test_tail);
+  run_test(test_tail_shares_cells);
   run_test(test_list);
   run_test(test_join);
   run_test(test_def);
   run_test(test_lambda);
+  run_test(test_lambda_rest_args);
+  run_test(test_partial_application);
+  run_test(test_if_and_compare);
+  run_test(test_tail_calls);
+  run_test(test_lexical_scope);
+  run_test(test_deep_recursion);
+  run_test(test_redefined_global);
+  run_test(test_builtin_calls);
+  run_test(test_arena_promotion);
+  run_test(test_shared_values_unchanged);
+  run_test(test_gc_collects_cycles);
+  run_test(test_env_many_bindings);
+  run_test(test_cells_grow_and_shrink);
 
   error_tests();
 
   return 1;
 }
 
+/*
+ * the whole suite runs on the tree-walker, again on the vm, and then in
+ * diff mode, where every input runs on both and they must print the same.
+ * --walk, --vm or --diff runs just that pass.
+ */
 int main(int argc, char **argv) {
-  int result = all_tests();
+  char *only = argc > 1 ? argv[1] : NULL;
+  int result = 1;
+  if (!only || strcmp(only, "--walk") == 0) {
+    result = all_tests();
+  }
+  if (result == 1 && (!only || strcmp(only, "--vm") == 0)) {
+    printf("\non the vm\n\n");
+    eval_vm = 1;
+    result = all_tests();
+    eval_vm = 0;
+  }
+  if (result == 1 && (!only || strcmp(only, "--diff") == 0)) {
+    printf("\non both, comparing what they print\n\n");
+    diff_mode = 1;
+    result = all_tests();
+    diff_mode = 0;
+  }
   if (result == 1) {
     printf("\nall tests passed!!\n");
   }
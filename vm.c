@@ -0,0 +1,1107 @@
+/* vm.c */
+
+#include "repl.h"
+
+/*
+ * an alternative to the tree-walker in eval.c, on when eval_vm is set
+ * (`./repl --vm`). an s-expression compiles to code that pushes each cell's
+ * value and then calls the first with the rest, so running it never
+ * copies or walks the tree. a lambda compiles its body on its first call
+ * and keeps the code.
+ *
+ * the result is the same as val_eval's, errors included: the first value
+ * to come out as an error abandons the rest of the code.
+ *
+ * calls avoid building argument lists where they can: arithmetic folds
+ * its arguments on the stack, and a lambda given exactly its parameters
+ * leaves them there as its locals, or binds them into a recycled frame
+ * when its body could def. anything else goes through val_call_tail.
+ *
+ * in a lambda's body, a param compiles to a load from its slot among the
+ * locals, and a captured symbol to one from the lambda's env, so only
+ * globals are looked up by name. each global lookup keeps the value it
+ * found with the env_version it found it at, and while no definition has
+ * been made since, the next one costs a compare.
+ *
+ * a call headed by the name of a number builtin, or an if, is compiled for
+ * that builtin (see vm_builtins): while the name is still bound to it, the
+ * call skips pushing it, and one on params and consts, like (- n 1), is
+ * done in a single op. otherwise the same code carries on as a plain call.
+ *
+ * a call just before the code returns is a tail call, and runs in place
+ * of the code that made it, like val_eval_sexpr's: a lambda with a frame
+ * that replaces the caller's, or the q-expression eval or if chose.
+ *
+ * no call recurses in C. a call that isn't in tail position saves where
+ * its caller was on a stack of calls on the heap, and the run carries on
+ * with the callee's code; returning pops back to the caller. so the
+ * depth of the lisp program is bounded by vm_max_depth, not by the C
+ * stack, and going past it is an error rather than a crash.
+ */
+
+int eval_vm = 0;
+
+enum {
+  OP_CONST,
+  OP_LOOKUP,
+  OP_GLOBAL,
+  OP_BUILTIN,
+  OP_ARITH,
+  OP_TEST,
+  OP_LOCAL,
+  OP_CAPTURED,
+  OP_EMPTY,
+  OP_CALL,
+  OP_TAILCALL,
+  OP_IF,
+  OP_JUMP,
+  OP_RETURN
+};
+
+#define VM_FRAMES 64
+
+int vm_max_depth = 100000;
+
+/*
+ * a call in progress: the code it is running and its env, and the frame
+ * and lambda it owns when it is a lambda's. pc is saved when it calls.
+ *
+ * a lambda's call can leave it and its arguments on the stack instead of
+ * binding a frame: held is where they start, and locals where the
+ * arguments do, or -1. the code eval and if run from it reads the same
+ * locals, and a frame is only bound if def or \ needs one (vm_frame_at).
+ */
+typedef struct {
+  Code *code;
+  int pc;
+  Env *env;
+  Env *frame;
+  Val *fn;
+  int locals;
+  int held;
+} VmCall;
+
+/*
+ * the value and call stacks, shared by nested runs; each only touches
+ * what it pushed
+ */
+typedef struct {
+  Val **stack;
+  int top;
+  int capacity;
+
+  VmCall *callstack;
+  int depth;
+  int depth_capacity;
+
+  /* a full call's frame is gone when it returns, so it can be reused */
+  Env *frames[VM_FRAMES];
+  int nframes;
+
+  long compiled;
+  long runs;
+  long calls;
+  long tails;
+  int deepest;
+  long global_hits;
+  long global_misses;
+} Vm;
+
+static Vm vm;
+
+/*
+ * the builtins a call can be compiled for, by the name at its head, so
+ * running it skips finding out what it calls. the name could be bound to
+ * something else by then, so the call still checks that it got this one:
+ * OP_BUILTIN, before the head's OP_GLOBAL, pushes NULL in place of the
+ * builtin while the global is still it, and the call takes NULL as it.
+ */
+typedef struct {
+  char *name;
+  BuiltIn func;
+  char *sym;
+  NumOp *num;
+  int cmp;
+} VmBuiltin;
+
+VmBuiltin vm_builtins[] = {
+  {"+", builtin_add}, {"-", builtin_sub}, {"*", builtin_mul},
+  {"/", builtin_div}, {"%", builtin_mod},
+  {"min", builtin_min}, {"max", builtin_max},
+  {"<", builtin_lt}, {"<=", builtin_le}, {">", builtin_gt},
+  {">=", builtin_ge}, {"==", builtin_eq}, {"!=", builtin_ne},
+  {"if", builtin_if},
+};
+
+#define VM_BUILTINS (int)(sizeof(vm_builtins) / sizeof(VmBuiltin))
+
+/* while vm_compile is sizing the code, there is nowhere to write yet */
+void code_emit(Code *c, int op) {
+  if (c->ops) { c->ops[c->count] = op; }
+  c->count++;
+}
+
+void code_patch(Code *c, int at, int op) {
+  if (c->ops) { c->ops[at] = op; }
+}
+
+/* a new const for v, without an op to use it */
+int code_const(Code *c, Val *v) {
+  if (c->consts) { c->consts[c->nconsts] = val_ref(v); }
+  return c->nconsts++;
+}
+
+/* emits op with a new const for v as its operand */
+void code_emit_const(Code *c, int op, Val *v) {
+  code_emit(c, op);
+  code_emit(c, code_const(c, v));
+}
+
+void code_del(Code *c) {
+  if (--c->refs) { return; }
+  for (int i = 0; i < c->nconsts; i++) {
+    if (c->consts[i]) { val_del(c->consts[i]); }
+    if (c->subs[i]) { code_del(c->subs[i]); }
+  }
+  free(c);
+}
+
+/* whether sym appears anywhere in v */
+int vm_mentions(Val *v, char *sym) {
+  for (int i = 0; i < v->count; i++) {
+    Val *c = v->cell[i];
+    if (val_type(c) == VAL_SYM && c->sym == sym) { return 1; }
+    if (val_type(c) == VAL_SEXPR || val_type(c) == VAL_QEXPR) {
+      if (vm_mentions(c, sym)) { return 1; }
+    }
+  }
+  return 0;
+}
+
+/*
+ * the lexical address of sym in lambda f's body: depth 0 for a slot of
+ * its call frame, which binds its params in order, or 1 for a slot of the
+ * lambda's own env (see lambda_capture). -1 when it has to be looked up
+ * by name, like a global. a def in the body could shadow a captured name
+ * from the frame, so then only params are resolved.
+ */
+int vm_resolve(Code *c, char *sym, int *slot) {
+  Val *f = c->fn;
+  if (!f) { return -1; }
+  int n = 0;
+  for (int i = 0; i < f->args->count; i++) {
+    char *p = f->args->cell[i]->sym;
+    if (strcmp(p, "&") == 0) { continue; }
+    if (p == sym) {
+      *slot = n;
+      return 0;
+    }
+    n++;
+  }
+  int i = env_find(f->env, sym);
+  if (i < 0 || c->local_defs) { return -1; }
+  *slot = i;
+  return 1;
+}
+
+/* f's params can't be addressed by position if a name repeats */
+int vm_params_distinct(Val *f) {
+  for (int i = 0; i < f->args->count; i++) {
+    for (int j = 0; j < i; j++) {
+      if (f->args->cell[i]->sym == f->args->cell[j]->sym) { return 0; }
+    }
+  }
+  return 1;
+}
+
+void vm_compile_cells(Code *c, Val *v, int sp, int tail);
+
+/* code leaving v's value on the stack above sp others */
+void vm_compile_expr(Code *c, Val *v, int sp) {
+  int slot;
+  int depth;
+  switch (val_type(v)) {
+    case VAL_SYM:
+      depth = vm_resolve(c, v->sym, &slot);
+      if (depth < 0) {
+        /* nothing but a global can answer to it from a lambda's frame */
+        code_emit_const(c, c->fn && !c->local_defs ? OP_GLOBAL : OP_LOOKUP, v);
+      } else {
+        code_emit(c, depth ? OP_CAPTURED : OP_LOCAL);
+        code_emit(c, slot);
+      }
+      break;
+    case VAL_SEXPR: vm_compile_cells(c, v, sp, 0); return;
+    default: code_emit_const(c, OP_CONST, v); break;
+  }
+  if (sp + 1 > c->depth) { c->depth = sp + 1; }
+}
+
+/* the index in vm_builtins of the builtin a call headed by v names, or -1 */
+int vm_builtin_hint(Code *c, Val *v) {
+  int slot;
+  if (val_type(v) != VAL_SYM || vm_resolve(c, v->sym, &slot) >= 0) {
+    return -1;
+  }
+  /* the names are interned the first time, so they compare as pointers */
+  if (!vm_builtins[0].sym) {
+    for (int i = 0; i < VM_BUILTINS; i++) {
+      VmBuiltin *b = &vm_builtins[i];
+      b->sym = sym_intern(b->name);
+      b->num = num_op(b->func);
+      b->cmp = cmp_op(b->func);
+    }
+  }
+  for (int i = 0; i < VM_BUILTINS; i++) {
+    if (v->sym == vm_builtins[i].sym) { return i; }
+  }
+  return -1;
+}
+
+/*
+ * a call's head v, which can go on the stack as NULL while it is the
+ * builtin hint names. only vm_compile_if's call takes if that way.
+ */
+void vm_compile_head(Code *c, Val *v, int sp, int hint) {
+  if (hint >= 0 && c->fn && !c->local_defs) {
+    code_emit(c, OP_BUILTIN);
+    code_emit(c, hint);
+  }
+  vm_compile_expr(c, v, sp);
+}
+
+/* a call of the n values on top of the stack */
+void vm_compile_call(Code *c, int tail, int n, int branch, int hint) {
+  code_emit(c, tail ? OP_TAILCALL : OP_CALL);
+  code_emit(c, n);
+  code_emit(c, branch);
+  code_emit(c, hint);
+}
+
+/* whether v is a call vm_compile_arith can make into an OP_ARITH */
+int vm_is_arith(Code *c, Val *v, int hint) {
+  if (hint < 0 || v->count != 3 || !c->fn || c->local_defs) { return 0; }
+  if (!vm_builtins[hint].num && !vm_builtins[hint].cmp) { return 0; }
+  int slot;
+  for (int i = 1; i < 3; i++) {
+    Val *a = v->cell[i];
+    int t = val_type(a);
+    if (t == VAL_SEXPR) { return 0; }
+    if (t == VAL_SYM && vm_resolve(c, a->sym, &slot) != 0) { return 0; }
+  }
+  return 1;
+}
+
+/*
+ * a call like (- n 1), of a number builtin on two params or consts. those
+ * can't run anything, so OP_ARITH checks the head and then does the whole
+ * call in one step, while the head is that builtin and both are fixnums.
+ * otherwise it goes on to the call compiled after it, which the operands
+ * point into: each a param's slot, or ~ the index of a const.
+ */
+int vm_compile_arith(Code *c, Val *v, int sp, int tail, int hint) {
+  if (!vm_is_arith(c, v, hint)) { return 0; }
+  int slot;
+  code_emit(c, OP_ARITH);
+  code_emit(c, hint);
+  int at = c->count;
+  for (int i = 0; i < 4; i++) { code_emit(c, 0); }
+
+  code_patch(c, at, c->nconsts);
+  vm_compile_head(c, v->cell[0], sp, hint);
+  for (int i = 1; i < 3; i++) {
+    Val *a = v->cell[i];
+    if (val_type(a) == VAL_SYM) {
+      vm_resolve(c, a->sym, &slot);
+    } else {
+      slot = ~c->nconsts;
+    }
+    code_patch(c, at + i, slot);
+    vm_compile_expr(c, a, sp + i);
+  }
+  vm_compile_call(c, tail, 3, -1, hint);
+  code_patch(c, at + 3, c->count);
+  return 1;
+}
+
+/*
+ * the end of a branch of an if: in tail position it returns, as the code
+ * after the if would straight away, and otherwise it jumps past the if to
+ * where the returned index is patched in
+ */
+int vm_compile_end(Code *c, int tail) {
+  if (tail) {
+    code_emit(c, OP_RETURN);
+    return -1;
+  }
+  code_emit(c, OP_JUMP);
+  code_emit(c, 0);
+  return c->count - 1;
+}
+
+/*
+ * (if c {a} {b}) runs a or b in place, without a call, while if is still
+ * the builtin when the call is made and c is a number. otherwise OP_IF
+ * goes on to the call as written, after both branches.
+ *
+ * when c is a call OP_ARITH can make, OP_TEST first tries the lot in one
+ * step: if and c's head are still the builtins and c's operands fixnums,
+ * it goes straight to a or b, and otherwise on to the code as above.
+ */
+int vm_compile_if(Code *c, Val *v, int sp, int tail) {
+  if (
+    v->count != 4 || val_type(v->cell[0]) != VAL_SYM ||
+    v->cell[0]->sym != sym_intern("if") ||
+    val_type(v->cell[2]) != VAL_QEXPR || val_type(v->cell[3]) != VAL_QEXPR
+  ) {
+    return 0;
+  }
+
+  int hint = vm_builtin_hint(c, v->cell[0]);
+  Val *cond = v->cell[1];
+  int test = -1;
+  if (
+    hint >= 0 && val_type(cond) == VAL_SEXPR && cond->count == 3 &&
+    vm_is_arith(c, cond, vm_builtin_hint(c, cond->cell[0]))
+  ) {
+    code_emit(c, OP_TEST);
+    test = c->count;
+    for (int i = 0; i < 4; i++) { code_emit(c, 0); }
+    code_patch(c, test, c->nconsts);
+  }
+  vm_compile_head(c, v->cell[0], sp, hint);
+  /* the operands of cond's OP_ARITH */
+  if (test >= 0) { code_patch(c, test + 1, c->count + 1); }
+  vm_compile_expr(c, cond, sp + 1);
+  code_emit(c, OP_IF);
+  int at = c->count;
+  code_emit(c, 0);
+  code_emit(c, 0);
+  if (test >= 0) { code_patch(c, test + 2, c->count); }
+
+  vm_compile_cells(c, v->cell[2], sp, tail);
+  int then_end = vm_compile_end(c, tail);
+
+  code_patch(c, at, c->count);
+  if (test >= 0) { code_patch(c, test + 3, c->count); }
+  vm_compile_cells(c, v->cell[3], sp, tail);
+  int else_end = vm_compile_end(c, tail);
+
+  code_patch(c, at + 1, c->count);
+  int branch = code_const(c, v->cell[2]);
+  code_const(c, v->cell[3]);
+  code_emit(c, OP_CONST);
+  code_emit(c, branch);
+  code_emit(c, OP_CONST);
+  code_emit(c, branch + 1);
+  vm_compile_call(c, tail, 4, branch, hint);
+
+  if (!tail) {
+    code_patch(c, then_end, c->count);
+    code_patch(c, else_end, c->count);
+  }
+  if (sp + 4 > c->depth) { c->depth = sp + 4; }
+  return 1;
+}
+
+/*
+ * v's cells as one s-expression, whatever v's type. in tail position, the
+ * call it ends in is a tail call.
+ */
+void vm_compile_cells(Code *c, Val *v, int sp, int tail) {
+  if (v->count == 0) {
+    code_emit(c, OP_EMPTY);
+    if (sp + 1 > c->depth) { c->depth = sp + 1; }
+    return;
+  }
+  /* like val_eval_sexpr, a single cell is its own value */
+  if (v->count == 1) {
+    if (val_type(v->cell[0]) == VAL_SEXPR) {
+      vm_compile_cells(c, v->cell[0], sp, tail);
+    } else {
+      vm_compile_expr(c, v->cell[0], sp);
+    }
+    return;
+  }
+  if (vm_compile_if(c, v, sp, tail)) { return; }
+  /* if is only called as the builtin in vm_compile_if's shape */
+  int hint = vm_builtin_hint(c, v->cell[0]);
+  if (hint >= 0 && vm_builtins[hint].func == builtin_if) { hint = -1; }
+  if (vm_compile_arith(c, v, sp, tail, hint)) { return; }
+
+  /*
+   * a call shaped like eval's or if's notes the const index of its first
+   * q-expression, so the branch it takes can find its code by index
+   */
+  int shape = v->count == 2 ? 1 : v->count == 4 ? 2 : 0;
+  int branch = -1;
+  for (int i = 0; i < v->count; i++) {
+    if (i == shape && val_type(v->cell[i]) == VAL_QEXPR) {
+      branch = c->nconsts;
+    }
+    if (i == 0) {
+      vm_compile_head(c, v->cell[i], sp, hint);
+    } else {
+      vm_compile_expr(c, v->cell[i], sp + i);
+    }
+  }
+  vm_compile_call(c, tail, v->count, branch, hint);
+}
+
+/*
+ * v's cells, in the body of lambda fn if there is one. a first pass with
+ * nowhere to write counts the ops and consts, so the code is allocated
+ * in one piece.
+ */
+Code *vm_compile(Val *v, Val *fn) {
+  Code size = {0};
+  size.fn = fn && vm_params_distinct(fn) ? fn : NULL;
+  size.local_defs = size.fn && vm_mentions(fn->body, sym_intern("def"));
+  vm_compile_cells(&size, v, 0, 1);
+  int ops = size.count + 1;
+  int consts = size.nconsts;
+
+  Code *c = malloc(
+    sizeof(Code) +
+    (sizeof(Val*) + sizeof(Code*) + sizeof(GlobalCache)) * consts +
+    sizeof(int) * ops
+  );
+  c->consts = (Val**)(c + 1);
+  c->subs = (Code**)(c->consts + consts);
+  c->globals = (GlobalCache*)(c->subs + consts);
+  c->ops = (int*)(c->globals + consts);
+  memset(c->subs, 0, sizeof(Code*) * consts);
+  for (int i = 0; i < consts; i++) { c->globals[i].version = -1; }
+  c->count = 0;
+  c->nconsts = 0;
+  c->depth = 0;
+  c->once = 0;
+  c->params = -1;
+  c->refs = 1;
+  c->fn = size.fn;
+  c->local_defs = size.local_defs;
+  vm_compile_cells(c, v, 0, 1);
+  code_emit(c, OP_RETURN);
+  vm.compiled++;
+  return c;
+}
+
+void vm_reserve(int n) {
+  if (vm.top + n <= vm.capacity) { return; }
+  vm.capacity = vm.capacity * 2 > vm.top + n ? vm.capacity * 2 : vm.top + n;
+  vm.stack = realloc(vm.stack, sizeof(Val*) * vm.capacity);
+}
+
+/* a lambda's code, compiled on its first call */
+Code *vm_code(Val *f) {
+  if (f->code) { return f->code; }
+  f->code = vm_compile(f->body, f);
+  f->code->params = f->args->count;
+  for (int i = 0; i < f->args->count; i++) {
+    if (strcmp(f->args->cell[i]->sym, "&") == 0) { f->code->params = -1; }
+  }
+  return f->code;
+}
+
+/* arena frames go with their line, so only the heap's are kept */
+Env *vm_frame_new(void) {
+#ifndef MEM_ARENA
+  if (vm.nframes) { return vm.frames[--vm.nframes]; }
+#endif
+  return env_new();
+}
+
+void vm_frame_del(Env *frame) {
+#ifndef MEM_ARENA
+  if (vm.nframes < VM_FRAMES) {
+    env_clear(frame);
+    vm.frames[vm.nframes++] = frame;
+    return;
+  }
+#endif
+  env_del(frame);
+}
+
+/* the n - 1 arguments above a popped call, as a list */
+Val *vm_args(int n) {
+  Val *args = val_sexpr();
+  val_reserve(args, n - 1);
+  memcpy(args->cell, vm.stack + vm.top + 1, sizeof(Val*) * (n - 1));
+  args->count = n - 1;
+  return args;
+}
+
+/* a call frame for lambda f, binding the arguments above it */
+Env *vm_bind(Env *e, Val *f, int n) {
+  Env *frame = vm_frame_new();
+  frame->parent = env_root(e);
+  for (int i = 1; i < n; i++) {
+    char *sym = f->args->cell[i - 1]->sym;
+    /* distinct params can't replace each other's bindings */
+    if (f->code->fn) {
+      env_push(frame, sym, vm.stack[vm.top + i]);
+    } else {
+      env_bind(frame, sym, vm.stack[vm.top + i]);
+      val_del(vm.stack[vm.top + i]);
+    }
+  }
+  frame->bound = f->env;
+  return frame;
+}
+
+/*
+ * a reference to the code for q, which eval or if is about to run from c.
+ * when q is c's const i, the code is compiled once and kept.
+ */
+Code *vm_branch_code(Code *c, Val *q, int i) {
+  if (i >= 0 && !c->once && c->consts[i] == q) {
+    if (!c->subs[i]) { c->subs[i] = vm_compile(q, c->fn); }
+    val_del(q);
+    c->subs[i]->refs++;
+    return c->subs[i];
+  }
+  Code *sub = vm_compile(q, c->fn);
+  val_del(q);
+  sub->once = 1;
+  return sub;
+}
+
+/*
+ * for well-formed eval and if, takes the argument they run off the stack
+ * into *q, with the const index it has if it is the call's own literal
+ * in *i, and returns 1. anything else is left for val_call_tail to check.
+ */
+int vm_branch(Val *f, int n, int branch, Val **q, int *i) {
+  Val **args = vm.stack + vm.top + 1;
+  int k;
+  if (f->func == builtin_eval && n == 2 && val_type(args[0]) == VAL_QEXPR) {
+    k = 0;
+  } else if (
+    f->func == builtin_if && n == 4 && val_type(args[0]) == VAL_NUM &&
+    val_type(args[1]) == VAL_QEXPR && val_type(args[2]) == VAL_QEXPR
+  ) {
+    k = args[0] != val_fixnum(0) ? 1 : 2;
+  } else {
+    return 0;
+  }
+
+  *q = args[k];
+  for (int j = 0; j < n - 1; j++) {
+    if (j != k) { val_del(args[j]); }
+  }
+  /* eval's q is at branch, and if's else is just after its then */
+  *i = branch < 0 ? -1 : branch + (k == 2);
+  return 1;
+}
+
+/*
+ * pops a call of f, the value n down the stack, with the n - 1 above it
+ * as arguments. f is only borrowed. returns the result when the call is
+ * done straight away; otherwise NULL, with the code that finishes it in
+ * *next and, for a lambda, its new frame in *callee, or in *locals where
+ * its arguments stay on the stack. branch is the const index
+ * vm_compile_cells noted for the call.
+ */
+Val *vm_enter(
+  Env *e, Code *c, Val *f, int n, int branch,
+  Code **next, Env **callee, int *locals
+) {
+  vm.calls++;
+  vm.top -= n;
+
+  if (val_type(f) != VAL_FUNC) {
+    for (int i = 1; i < n; i++) { val_del(vm.stack[vm.top + i]); }
+    char *given = type_name(val_type(f));
+    char *expected = type_name(VAL_FUNC);
+    return val_err(err_cell_arg_type(0, expected, given));
+  }
+
+  /* arithmetic folds its arguments where they are, without a list */
+  NumOp *op;
+  if (f->func && (op = num_op(f->func))) {
+    Val *r = num_fold(op, vm.stack + vm.top + 1, n - 1);
+    for (int i = 1; i < n; i++) { val_del(vm.stack[vm.top + i]); }
+    return r;
+  }
+
+  int mask;
+  if (f->func && (mask = cmp_op(f->func))) {
+    Val *r = num_compare(mask, vm.stack + vm.top + 1, n - 1);
+    for (int i = 1; i < n; i++) { val_del(vm.stack[vm.top + i]); }
+    return r;
+  }
+
+  /* eval and if go straight to the code for their branch */
+  Val *q;
+  int i;
+  if (f->func && vm_branch(f, n, branch, &q, &i)) {
+    *next = vm_branch_code(c, q, i);
+    return NULL;
+  }
+
+  if (!f->func && vm_code(f)->params == n - 1) {
+    *next = f->code;
+    f->code->refs++;
+    /* code that finds every param by slot can read them off the stack */
+    if (f->code->fn && !f->code->local_defs) {
+      vm.top += n;
+      *locals = vm.top - n + 1;
+      return NULL;
+    }
+    *callee = vm_bind(e, f, n);
+    return NULL;
+  }
+
+  Val *r = val_call_tail(e, f, vm_args(n), &q, callee);
+  if (r) { return r; }
+  if (*callee) {
+    val_del(q);
+    *next = vm_code(f);
+    (*next)->refs++;
+  } else {
+    *next = vm_branch_code(c, q, -1);
+  }
+  return NULL;
+}
+
+/*
+ * b of fixnums x and y, for the builtins with a quick way, or NULL. they
+ * add or subtract without overflowing a long, and val_num checks the
+ * result still fits; a product that overflows goes the long way.
+ */
+Val *vm_fixnums(VmBuiltin *b, Val *x, Val *y) {
+  if (!val_is_fixnum(x) || !val_is_fixnum(y)) { return NULL; }
+  long i = val_get_num(x);
+  long j = val_get_num(y);
+  if (b->cmp) { return val_fixnum((b->cmp >> ((i > j) - (i < j) + 1)) & 1); }
+  if (b->func == builtin_add) { return val_num(i + j); }
+  if (b->func == builtin_sub) { return val_num(i - j); }
+  long r;
+  if (b->func == builtin_mul && !__builtin_mul_overflow(i, j, &r)) {
+    return val_num(r);
+  }
+  return NULL;
+}
+
+/*
+ * pops a call of b, with the n - 1 values above it as arguments. if only
+ * gets here when its condition isn't a number, which is an error, so
+ * calling it can't recurse.
+ */
+Val *vm_builtin(Env *e, VmBuiltin *b, int n) {
+  vm.calls++;
+  vm.top -= n;
+  if (b->func == builtin_if) { return b->func(e, vm_args(n)); }
+  Val **args = vm.stack + vm.top + 1;
+  Val *r;
+  if (n == 3 && (r = vm_fixnums(b, args[0], args[1]))) { return r; }
+  r = b->num ?
+    num_fold(b->num, args, n - 1) :
+    num_compare(b->cmp, args, n - 1);
+  for (int i = 0; i < n - 1; i++) { val_del(args[i]); }
+  return r;
+}
+
+/* an OP_ARITH operand, a param's value or ~ a const's index, borrowed */
+Val *vm_operand(Env *e, Code *c, int locals, int a) {
+  if (a < 0) { return c->consts[~a]; }
+  return locals >= 0 ? vm.stack[locals + a] : e->vals[a];
+}
+
+/* a call's head can be NULL on the stack, for a builtin (see OP_BUILTIN) */
+void vm_pop_del(void) {
+  Val *v = vm.stack[--vm.top];
+  if (v) { val_del(v); }
+}
+
+/* gives up what a call owns, as it returns or is replaced */
+void vm_leave(VmCall *k) {
+  if (k->frame) {
+    vm_frame_del(k->frame);
+    val_del(k->fn);
+  }
+  k->frame = NULL;
+  k->fn = NULL;
+}
+
+/* drops what a call holds on the stack, which is everything from held up */
+void vm_drop(VmCall *k) {
+  if (k->held < 0) { return; }
+  while (vm.top > k->held) { vm_pop_del(); }
+  k->held = -1;
+}
+
+/*
+ * a tail call's lambda and arguments, the n values on top, take the place
+ * of what the call they replace held
+ */
+void vm_slide(VmCall *k, int n) {
+  int from = vm.top - n;
+  if (k->held < 0) {
+    k->held = from;
+    return;
+  }
+  for (int i = k->held; i < from; i++) { val_del(vm.stack[i]); }
+  memmove(vm.stack + k->held, vm.stack + from, sizeof(Val*) * n);
+  vm.top = k->held + n;
+}
+
+/*
+ * binds the locals at the top call's on the stack into a frame, for a
+ * builtin that needs them by name: def binds beside them and \ captures
+ * them. every call reading them switches to the frame, and the call that
+ * holds them owns it.
+ */
+Env *vm_frame_at(Env *e, int locals) {
+  Val *f = vm.stack[locals - 1];
+  Env *frame = vm_frame_new();
+  frame->parent = e;
+  frame->bound = f->env;
+  for (int i = 0; i < f->code->params; i++) {
+    env_push(frame, f->args->cell[i]->sym, val_ref(vm.stack[locals + i]));
+  }
+  for (int d = vm.depth - 1; d >= 0 && vm.callstack[d].locals == locals; d--) {
+    VmCall *k = &vm.callstack[d];
+    k->locals = -1;
+    k->env = frame;
+    if (k->held == locals - 1) {
+      k->frame = frame;
+      k->fn = val_ref(f);
+      break;
+    }
+  }
+  return frame;
+}
+
+/* a new call on top of the call stack, or NULL if it is full */
+VmCall *vm_push(Code *c, Env *e) {
+  if (vm.depth == vm_max_depth) { return NULL; }
+  if (vm.depth == vm.depth_capacity) {
+    vm.depth_capacity = vm.depth_capacity ? vm.depth_capacity * 2 : 64;
+    vm.callstack = realloc(vm.callstack, sizeof(VmCall) * vm.depth_capacity);
+  }
+  VmCall *k = &vm.callstack[vm.depth++];
+  if (vm.depth > vm.deepest) { vm.deepest = vm.depth; }
+  k->code = c;
+  k->pc = 0;
+  k->env = e;
+  k->frame = NULL;
+  k->fn = NULL;
+  k->locals = -1;
+  k->held = -1;
+  return k;
+}
+
+/* drops every call above bottom and every value above base, for an error */
+Val *vm_unwind(int bottom, int base) {
+  while (vm.depth > bottom) {
+    VmCall *k = &vm.callstack[--vm.depth];
+    vm_leave(k);
+    code_del(k->code);
+  }
+  Val *err = vm.stack[--vm.top];
+  while (vm.top > base) { vm_pop_del(); }
+  return err;
+}
+
+Val *vm_run(Env *e, Code *c) {
+  int base = vm.top;
+  int bottom = vm.depth;
+  vm.runs++;
+
+  VmCall *k = vm_push(c, e);
+  if (!k) { return val_err(err_fixed(ERR_STANDARD, "stack depth exceeded")); }
+  c->refs++;
+
+  vm_reserve(c->depth);
+  int *ops = c->ops;
+  int pc = 0;
+  int locals = -1;
+  while (1) {
+    Val *x;
+    int op = ops[pc++];
+    switch (op) {
+      case OP_CONST:
+        x = c->consts[ops[pc]];
+        if (c->once) {
+          c->consts[ops[pc]] = NULL;
+        } else {
+          val_ref(x);
+        }
+        pc++;
+        vm.stack[vm.top++] = x;
+        continue;
+      case OP_LOOKUP: x = env_get(e, c->consts[ops[pc++]]); break;
+      case OP_GLOBAL: {
+        GlobalCache *g = &c->globals[ops[pc]];
+        if (g->version == env_version) {
+          vm.global_hits++;
+          x = val_ref(g->val);
+        } else {
+          vm.global_misses++;
+          char *sym = c->consts[ops[pc]]->sym;
+          x = env_get(e, c->consts[ops[pc]]);
+          /* an eval could still def it in this frame, which isn't global */
+          int local = e->parent && (
+            env_find(e, sym) >= 0 ||
+            (e->bound && env_find(e->bound, sym) >= 0)
+          );
+          if (val_type(x) != VAL_ERR && !local) {
+            g->version = env_version;
+            g->val = x;
+            g->func = val_type(x) == VAL_FUNC ? x->func : NULL;
+          }
+        }
+        pc++;
+        break;
+      }
+      case OP_BUILTIN: {
+        /* the OP_GLOBAL after it looks the head up, unless it is skipped */
+        GlobalCache *g = &c->globals[ops[pc + 2]];
+        if (
+          g->version == env_version &&
+          g->func == vm_builtins[ops[pc]].func
+        ) {
+          vm.global_hits++;
+          vm.stack[vm.top++] = NULL;
+          pc += 3;
+        } else {
+          pc++;
+        }
+        continue;
+      }
+      case OP_ARITH: {
+        VmBuiltin *b = &vm_builtins[ops[pc]];
+        GlobalCache *g = &c->globals[ops[pc + 1]];
+        if (g->version == env_version && g->func == b->func) {
+          x = vm_fixnums(
+            b,
+            vm_operand(e, c, locals, ops[pc + 2]),
+            vm_operand(e, c, locals, ops[pc + 3])
+          );
+          if (x) {
+            vm.global_hits++;
+            vm.calls++;
+            vm.stack[vm.top++] = x;
+            pc = ops[pc + 4];
+            continue;
+          }
+        }
+        pc += 5;
+        continue;
+      }
+      case OP_TEST: {
+        GlobalCache *g = &c->globals[ops[pc]];
+        int *a = ops + ops[pc + 1];
+        VmBuiltin *b = &vm_builtins[a[0]];
+        GlobalCache *h = &c->globals[a[1]];
+        if (
+          g->version == env_version && g->func == builtin_if &&
+          h->version == env_version && h->func == b->func &&
+          (x = vm_fixnums(
+            b, vm_operand(e, c, locals, a[2]), vm_operand(e, c, locals, a[3])
+          ))
+        ) {
+          vm.global_hits += 2;
+          vm.calls++;
+          pc = x != val_fixnum(0) ? ops[pc + 2] : ops[pc + 3];
+          val_del(x);
+          continue;
+        }
+        pc += 4;
+        continue;
+      }
+      case OP_LOCAL:
+        x = locals >= 0 ? vm.stack[locals + ops[pc]] : e->vals[ops[pc]];
+        vm.stack[vm.top++] = val_ref(x);
+        pc++;
+        continue;
+      case OP_CAPTURED:
+        x = locals >= 0 ?
+          vm.stack[locals - 1]->env->vals[ops[pc]] :
+          e->bound->vals[ops[pc]];
+        vm.stack[vm.top++] = val_ref(x);
+        pc++;
+        continue;
+      case OP_EMPTY: x = val_sexpr(); break;
+      case OP_IF: {
+        Val *f = vm.stack[vm.top - 2];
+        Val *cond = vm.stack[vm.top - 1];
+        if (
+          (f && (val_type(f) != VAL_FUNC || f->func != builtin_if)) ||
+          val_type(cond) != VAL_NUM
+        ) {
+          pc = ops[pc + 1];
+          continue;
+        }
+        vm.top -= 2;
+        pc = cond != val_fixnum(0) ? pc + 2 : ops[pc];
+        val_del(cond);
+        if (f) { val_del(f); }
+        continue;
+      }
+      case OP_JUMP: pc = ops[pc]; continue;
+      case OP_CALL:
+      case OP_TAILCALL: {
+        int n = ops[pc++];
+        int branch = ops[pc++];
+        int hint = ops[pc++];
+        Val *f = vm.stack[vm.top - n];
+        if (!f) {
+          x = vm_builtin(e, &vm_builtins[hint], n);
+          break;
+        }
+        if (
+          hint >= 0 && val_type(f) == VAL_FUNC &&
+          f->func == vm_builtins[hint].func
+        ) {
+          x = vm_builtin(e, &vm_builtins[hint], n);
+          val_del(f);
+          break;
+        }
+        if (
+          locals >= 0 && val_type(f) == VAL_FUNC &&
+          (f->func == builtin_def || f->func == builtin_lambda)
+        ) {
+          e = vm_frame_at(e, locals);
+          locals = -1;
+        }
+        Code *next = NULL;
+        Env *callee = NULL;
+        int callee_locals = -1;
+        x = vm_enter(e, c, f, n, branch, &next, &callee, &callee_locals);
+        if (x) {
+          val_del(f);
+          break;
+        }
+
+        if (op == OP_TAILCALL) {
+          vm.tails++;
+          if (callee) {
+            vm_leave(k);
+            vm_drop(k);
+          } else if (callee_locals >= 0) {
+            vm_leave(k);
+            vm_slide(k, n);
+            callee_locals = k->held + 1;
+          }
+          code_del(c);
+        } else {
+          k->pc = pc;
+          VmCall *callee_k = vm_push(next, e);
+          if (!callee_k) {
+            if (callee) { vm_frame_del(callee); }
+            if (callee_locals >= 0) {
+              vm.top -= n;
+              for (int i = 1; i < n; i++) { val_del(vm.stack[vm.top + i]); }
+            }
+            val_del(f);
+            code_del(next);
+            x = val_err(err_fixed(ERR_STANDARD, "stack depth exceeded"));
+            break;
+          }
+          k = callee_k;
+          if (callee_locals >= 0) { k->held = callee_locals - 1; }
+        }
+
+        if (callee) {
+          k->frame = callee;
+          k->fn = f;
+          e = callee;
+          locals = -1;
+        } else if (callee_locals >= 0) {
+          /* the stack holds f, so fn is only for vm_stack_fn */
+          k->fn = f;
+          e = env_root(e);
+          locals = callee_locals;
+        } else {
+          val_del(f);
+        }
+        k->code = c = next;
+        k->env = e;
+        k->locals = locals;
+        ops = c->ops;
+        pc = 0;
+        vm_reserve(c->depth);
+        continue;
+      }
+      default:
+        x = vm.stack[--vm.top];
+        vm_drop(k);
+        vm_leave(k);
+        code_del(c);
+        if (--vm.depth == bottom) { return x; }
+        k = &vm.callstack[vm.depth - 1];
+        c = k->code;
+        e = k->env;
+        locals = k->locals;
+        ops = c->ops;
+        pc = k->pc;
+        break;
+    }
+
+    /* calls may have moved the stack, but left it reserved */
+    vm.stack[vm.top++] = x;
+    if (val_type(x) == VAL_ERR) { return vm_unwind(bottom, base); }
+  }
+}
+
+/* takes v, like val_eval, and evaluates its cells as an s-expression */
+Val *vm_eval(Env *e, Val *v) {
+  Code *c = vm_compile(v, NULL);
+  val_del(v);
+  c->once = 1;
+  Val *r = vm_run(e, c);
+  code_del(c);
+  return r;
+}
+
+/* runs a lambda's body in its call frame e */
+Val *vm_call(Env *e, Val *f) {
+  return vm_run(e, vm_code(f));
+}
+
+/*
+ * for profilers, which can sample these from anywhere: how many calls
+ * are in progress, and the lambda making the i'th from the top, or NULL
+ * when that is eval, if or a run from outside the vm
+ */
+int vm_stack_depth(void) {
+  return vm.depth;
+}
+
+Val *vm_stack_fn(int i) {
+  return vm.callstack[vm.depth - 1 - i].fn;
+}
+
+void vm_print_stack(void) {
+  printf("stack: %i deep\n", vm.depth);
+  for (int i = 0; i < vm.depth; i++) {
+    Val *f = vm_stack_fn(i);
+    if (f) {
+      printf("  ");
+      val_println(f);
+    }
+  }
+}
+
+void vm_print_stats(void) {
+  printf(
+    "vm: %s, compiled %li, runs %li, calls %li, tail calls %li, deepest %i of %i\n",
+    eval_vm ? "on" : "off",
+    vm.compiled,
+    vm.runs,
+    vm.calls,
+    vm.tails,
+    vm.deepest,
+    vm_max_depth
+  );
+  long lookups = vm.global_hits + vm.global_misses;
+  printf(
+    "vm globals: %li lookups, %li hits (%.1f%%), %li misses\n",
+    lookups,
+    vm.global_hits,
+    lookups ? 100.0 * vm.global_hits / lookups : 0.0,
+    vm.global_misses
+  );
+}